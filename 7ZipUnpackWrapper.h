@@ -1,48 +1,173 @@
-#============================================================================
-# 7ZIP (liblzma) easy extraction functions wrapper
-#-------------------------------------------------
-#
-# Author: Salavat Tulebaev (salavat-tulebaev@yandex.ru), 2010.
-#
-# Copyright 2010 Alexander Potemkin (dispatch.mailbox@gmail.com)
-#
-#   Licensed under the Apache License, Version 2.0 (the "License");
-#   you may not use this file except in compliance with the License.
-#   You may obtain a copy of the License at
-#
-#       http://www.apache.org/licenses/LICENSE-2.0
-#
-#   Unless required by applicable law or agreed to in writing, software
-#   distributed under the License is distributed on an "AS IS" BASIS,
-#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-#   See the License for the specific language governing permissions and
-#   limitations under the License.
-#============================================================================
-
-#ifndef _LIBLZMA_H
-#define _LIBLZMA_H
-
-#define SZ_OK 0
-#define SZ_ERROR_DATA 1
-#define SZ_ERROR_MEM 2
-#define SZ_ERROR_CRC 3
-#define SZ_ERROR_UNSUPPORTED 4
-#define SZ_ERROR_PARAM 5
-#define SZ_ERROR_INPUT_EOF 6
-#define SZ_ERROR_OUTPUT_EOF 7
-#define SZ_ERROR_READ 8
-#define SZ_ERROR_WRITE 9
-#define SZ_ERROR_PROGRESS 10
-#define SZ_ERROR_FAIL 11
-#define SZ_ERROR_THREAD 12
-#define SZ_ERROR_ARCHIVE 16
-#define SZ_ERROR_NO_ARCHIVE 17
-
-/* Call CrcGenerateTable one time before other CRC functions */
-void CrcGenerateTable(void);
-
-int List7zFiles(char* archiveFile);
-int Decode7zOneFile(char* archiveFile, char* fileName);
-int Decode7zFiles(char* archiveFile, int fullPaths);
-
-#endif
+#============================================================================
+# 7ZIP (liblzma) easy extraction functions wrapper
+#-------------------------------------------------
+#
+# Author: Salavat Tulebaev (salavat-tulebaev@yandex.ru), 2010.
+#
+# Copyright 2010 Alexander Potemkin (dispatch.mailbox@gmail.com)
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#============================================================================
+
+#ifndef _LIBLZMA_H
+#define _LIBLZMA_H
+
+#include <stddef.h>
+
+#define SZ_OK 0
+#define SZ_ERROR_DATA 1
+#define SZ_ERROR_MEM 2
+#define SZ_ERROR_CRC 3
+#define SZ_ERROR_UNSUPPORTED 4
+#define SZ_ERROR_PARAM 5
+#define SZ_ERROR_INPUT_EOF 6
+#define SZ_ERROR_OUTPUT_EOF 7
+#define SZ_ERROR_READ 8
+#define SZ_ERROR_WRITE 9
+#define SZ_ERROR_PROGRESS 10
+#define SZ_ERROR_FAIL 11
+#define SZ_ERROR_THREAD 12
+#define SZ_ERROR_ARCHIVE 16
+#define SZ_ERROR_NO_ARCHIVE 17
+
+/* Call CrcGenerateTable one time before other CRC functions */
+void CrcGenerateTable(void);
+
+int List7zFiles(char* archiveFile);
+int Decode7zOneFile(char* archiveFile, char* fileName);
+int Decode7zFiles(char* archiveFile, int fullPaths);
+/* Same as Decode7zFiles, but solid blocks are decoded by up to numThreads threads */
+int Decode7zFilesMt(char* archiveFile, int fullPaths, int numThreads);
+/* The same functions for archive 'data' of 'size' bytes in memory: the archive is read
+  directly from that memory, without copying and without files */
+int List7zFilesMem(const void *data, size_t size);
+int Decode7zOneFileMem(const void *data, size_t size, char* fileName);
+int Decode7zFilesMem(const void *data, size_t size, int fullPaths);
+int Decode7zFilesMtMem(const void *data, size_t size, int fullPaths, int numThreads);
+/* Number of threads for decoding of one LZMA2 stream in Decode7zOneFile and Extract7zFile, 1 by default */
+void Set7zNumThreads(int numThreads);
+/* Decode the files, that are the only ones in their solid blocks (non-solid archives),
+  directly to the memory-mapped output files, without copying through the file stream.
+  'enable==0' by default */
+void Set7zMapOutFiles(int enable);
+/* Read the archive through buffer of 'bufSize' bytes instead of mapping it to memory,
+  'adaptive==1' - small reads after each seek, and reads growing up to 'bufSize' for
+  sequential data. 0 (default) - the archive is mapped to memory, and buffer of 256 KB
+  is used, if the archive can not be mapped */
+void Set7zInBufSize(unsigned bufSize, int adaptive);
+/* Read the archive by separate thread with reads of 'bufSize' bytes to one of two buffers,
+  while the data of other buffer is decoded, instead of mapping the archive to memory
+  (for network storage and cold disks). 0 (default) - the archive is mapped to memory */
+void Set7zReadAhead(unsigned bufSize);
+/* Write the files in Decode7zFiles by separate thread, while next data is decoded,
+  'maxQueuedSize' - the maximum size of decoded data waiting for writing,
+  0 (default) - the files are written by decoding thread */
+void Set7zWriteBehind(unsigned maxQueuedSize);
+/* Keep the index files of archives, that are opened by Open7zArchive, in the directory 'dir':
+  the parsed header is written to the index at the first open, and the next opens map
+  the index instead of reading and decoding of the header, while the archive is not changed.
+  'dir' must exist, and the string must stay valid. NULL (default) - no index cache */
+void Set7zIndexCache(const char *dir);
+
+/* Archive handle: the archive is opened and its header is parsed one time,
+  the last decoded solid block and decoder tables are kept between extractions.
+  The names, times and attributes of files are read from the header at their first use,
+  so opening for the count and sizes of files doesn't read them */
+typedef struct C7zArchive C7zArchive;
+
+int Open7zArchive(char* archiveFile, C7zArchive **archive);
+/* The archive in memory, 'data' must stay valid until Close7zArchive */
+int Open7zArchiveMem(const void *data, size_t size, C7zArchive **archive);
+void Close7zArchive(C7zArchive *archive);
+/* Number of files and directories in archive */
+unsigned Get7zNumFiles(C7zArchive *archive);
+/* Memory of archive header, 'temp==0' - the data kept while the archive is open
+  (it grows, when the names, times and attributes are read),
+  'temp==1' - the temporary buffers of header parsing: 'numBytes' in 'numAllocs'
+  allocations, that are placed in 'numChunks' memory blocks taken from the system */
+void Get7zHeaderMemStat(C7zArchive *archive, int temp, size_t *numBytes, size_t *numAllocs, size_t *numChunks);
+/* Index of 'fileName' (full path in archive with '/' separators), -1 if it's not found */
+int Find7zFile(C7zArchive *archive, char* fileName);
+/* Extract one file, 'fullPaths==1' - with its directories.
+  Returns SZ_ERROR_PARAM, if there is no such file in archive */
+int Extract7zFile(C7zArchive *archive, unsigned fileIndex, int fullPaths);
+int Extract7zFileByName(C7zArchive *archive, char* fileName, int fullPaths);
+/* Extract several files: each solid block is decoded one time, and only up to its last requested file */
+int Extract7zFiles(C7zArchive *archive, const unsigned *fileIndexes, unsigned numFiles, int fullPaths);
+int Extract7zFilesByName(C7zArchive *archive, char **fileNames, unsigned numFiles, int fullPaths);
+
+/* Extraction to memory: the decoded data of files is passed to the callbacks instead
+  of writing it to the disk. The callbacks return 0 to continue, other value stops the
+  extraction and it's returned by Extract7zFilesToMem */
+typedef struct C7zFileInfo
+{
+  unsigned index;
+  const char *name; /* full path in archive, UTF-8 with '/' separators */
+  unsigned long long size;
+  unsigned attrib; /* Windows attributes, if 'attribDefined' */
+  int attribDefined;
+  int isDir;
+} C7zFileInfo;
+
+typedef struct C7zMemCallback
+{
+  void *ctx;
+  /* the start of file (directories and empty files too), '*skip = 1' - its data is not needed */
+  int (*Begin)(void *ctx, const C7zFileInfo *info, int *skip);
+  /* the next part of data of the file, the pointer is valid only during the call */
+  int (*Data)(void *ctx, unsigned fileIndex, const void *data, size_t size);
+  /* the end of file, that was not skipped: 'res' - 0 or SZ_ERROR_CRC */
+  int (*End)(void *ctx, unsigned fileIndex, int res);
+} C7zMemCallback;
+
+/* Extract files 'fileIndexes' (all files, if 'fileIndexes==NULL') to the callbacks,
+  in order of their data in archive: each solid block is decoded one time */
+int Extract7zFilesToMem(C7zArchive *archive, const unsigned *fileIndexes, unsigned numFiles, const C7zMemCallback *callback);
+/* Size of file 'fileIndex' */
+unsigned long long Get7zFileSize(C7zArchive *archive, unsigned fileIndex);
+/* Extract file 'fileIndex' to 'buf' of 'bufSize' bytes, '*size' - the size of file.
+  Returns SZ_ERROR_OUTPUT_EOF, if the buffer is smaller than the file */
+int Extract7zFileToBuf(C7zArchive *archive, unsigned fileIndex, void *buf, size_t bufSize, size_t *size);
+
+/* Listing from the archive header, without decoding of data */
+typedef struct C7zListEntry
+{
+  const char *name; /* full path in archive, UTF-8 with '/' separators */
+  size_t nameLen; /* length of name in bytes */
+  unsigned long long size;
+  unsigned long long mtime; /* FILETIME: 100-ns intervals since 1601, if 'mtimeDefined' */
+  unsigned folder; /* solid block of data, (unsigned)-1 for directories and empty files */
+  unsigned crc; /* CRC32 of data, if 'crcDefined' */
+  unsigned attrib; /* Windows attributes, if 'attribDefined' */
+  unsigned char crcDefined;
+  unsigned char mtimeDefined;
+  unsigned char attribDefined;
+  unsigned char isDir;
+} C7zListEntry;
+
+/* Entries of all files, the array is valid until Close7zArchive */
+int Get7zListEntries(C7zArchive *archive, const C7zListEntry **entries, unsigned *numEntries);
+
+/* TSV: the line of field names (name, size, folder, crc, mtime, attrib, isDir) and
+  the line of each file, undefined fields are empty, crc is hex and other numbers are decimal,
+  tabs, line breaks and '\\' in names are escaped.
+  JSON: JSON object with the same fields in each line, undefined fields are null */
+#define LIST7Z_FORMAT_TSV 0
+#define LIST7Z_FORMAT_JSON 1
+
+/* Write entries to 'outFile' (stdout, if 'outFile==NULL') through one buffer */
+int Write7zList(C7zArchive *archive, const char *outFile, int format);
+/* Open archive, write its entries and close it */
+int List7zFilesFormat(char* archiveFile, const char *outFile, int format);
+
+#endif
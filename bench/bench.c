@@ -0,0 +1,611 @@
+/* bench.c -- benchmarks of liblzma and 7ZipUnpackWrapper
+2010-12-01 : Public domain */
+
+/*
+How to build:
+
+1. cd liblzma
+
+2. make -f makefile.unix
+
+3. gcc -O2 -I. ../bench/bench.c liblzma.a -lpthread -o ../bench/bench
+
+How to run:
+
+bench crc [sizeMB]
+  CRC32 of 'sizeMB' (16 by default) megabytes of random data with each CRC function:
+  byte-wise loop, slicing-by-4, 8 and 16, and the hardware versions (PCLMULQDQ on x86,
+  CRC32 instructions on ARMv8), if the CPU supports them, and CrcUpdate, that uses the
+  function selected by CrcGenerateTable. Each function is also checked with the byte-wise
+  loop for random parts of data.
+
+bench offsets [numFiles]
+  Generated solid archive of 'numFiles' (100000 by default) small files with Copy method:
+  - the offsets of all files in their solid block, as sums of sizes of previous files of
+    the block (it was the code of SzArEx_Extract), and from FileUnpackPos table;
+  - SzArEx_Extract of each file, with the cached solid block.
+
+bench list [numFiles [outFile]]
+  Generated archive of 'numFiles' (1000000 by default) small files in 1000 directories:
+  Open7zArchiveMem, Get7zListEntries, and Write7zList in TSV and JSON formats to 'outFile'
+  (/dev/null by default, the JSON output replaces the TSV output).
+
+The time is CPU time (clock), each test is repeated until it takes 1 second at least.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "7z.h"
+#include "7zAlloc.h"
+#include "7zBuf.h"
+#include "7zCrc.h"
+#include "CpuArch.h"
+
+typedef UInt32 (MY_FAST_CALL *CRC_FUNC)(UInt32 v, const void *data, size_t size, const UInt32 *table);
+
+#ifdef MY_CPU_LE
+UInt32 MY_FAST_CALL CrcUpdateT4(UInt32 v, const void *data, size_t size, const UInt32 *table);
+UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const UInt32 *table);
+UInt32 MY_FAST_CALL CrcUpdateT16(UInt32 v, const void *data, size_t size, const UInt32 *table);
+#ifdef MY_CPU_X86_OR_AMD64
+UInt32 MY_FAST_CALL CrcUpdatePclmul(UInt32 v, const void *data, size_t size, const UInt32 *table);
+#endif
+#ifdef MY_CPU_ARM64
+UInt32 MY_FAST_CALL CrcUpdateArm(UInt32 v, const void *data, size_t size, const UInt32 *table);
+#endif
+#endif
+
+#define MIN_TIME 1.0
+
+static double GetSeconds(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* the same data in each run, it doesn't depend on rand() of C library */
+static UInt32 g_RandState = 1;
+
+static UInt32 Rand32(void)
+{
+  g_RandState = g_RandState * 1664525 + 1013904223;
+  return g_RandState;
+}
+
+/* 7ZipUnpackWrapper functions (LibLzmaShells.c in liblzma.a) */
+typedef struct C7zArchive C7zArchive;
+typedef struct C7zListEntry C7zListEntry;
+int Open7zArchiveMem(const void *data, size_t size, C7zArchive **archive);
+void Close7zArchive(C7zArchive *archive);
+int Get7zListEntries(C7zArchive *archive, const C7zListEntry **entries, unsigned *numEntries);
+int Write7zList(C7zArchive *archive, const char *outFile, int format);
+#define LIST7Z_FORMAT_TSV 0
+#define LIST7Z_FORMAT_JSON 1
+
+static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+/* 7ZipUnpackWrapper functions (LibLzmaShells.c in liblzma.a) */
+typedef struct C7zArchive C7zArchive;
+typedef struct C7zListEntry C7zListEntry;
+int Open7zArchiveMem(const void *data, size_t size, C7zArchive **archive);
+void Close7zArchive(C7zArchive *archive);
+int Get7zListEntries(C7zArchive *archive, const C7zListEntry **entries, unsigned *numEntries);
+int Write7zList(C7zArchive *archive, const char *outFile, int format);
+#define LIST7Z_FORMAT_TSV 0
+#define LIST7Z_FORMAT_JSON 1
+
+static ISzAlloc g_AllocTemp = { SzAllocTemp, SzFreeTemp };
+
+/* ---------- CRC ---------- */
+
+static UInt32 MY_FAST_CALL CrcUpdateT1(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0; size--, p++)
+    v = table[(v ^ *p) & 0xFF] ^ (v >> 8);
+  return v;
+}
+
+/* CrcUpdate: the function that is selected by CrcGenerateTable */
+static UInt32 MY_FAST_CALL CrcUpdateSelected(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  table = table;
+  return CrcUpdate(v, data, size);
+}
+
+/* 'True' - 'func' returns the same CRC as byte-wise loop for random parts of 'data',
+  so the unaligned starts and the tails of all lengths are checked */
+static Bool CheckCrcFunc(CRC_FUNC func, const Byte *data, size_t size)
+{
+  unsigned i;
+  for (i = 0; i < 3000; i++)
+  {
+    size_t pos = Rand32() % size;
+    size_t len = Rand32() % (i < 1000 ? 64 : 4096);
+    if (len > size - pos)
+      len = size - pos;
+    if (func(CRC_INIT_VAL, data + pos, len, g_CrcTable) != CrcUpdateT1(CRC_INIT_VAL, data + pos, len, g_CrcTable))
+      return False;
+  }
+  return True;
+}
+
+/* returns 1, if the CRC of function differs from 'crcRef' */
+static int BenchCrcFunc(const char *name, CRC_FUNC func, const Byte *data, size_t size, UInt32 crcRef)
+{
+  unsigned numPasses = 0;
+  double t;
+  UInt32 crc;
+  clock_t start = clock();
+  do
+  {
+    crc = CRC_GET_DIGEST(func(CRC_INIT_VAL, data, size, g_CrcTable));
+    numPasses++;
+  }
+  while ((t = GetSeconds(start)) < MIN_TIME);
+  printf("%-9s %08X %8.0f MB/s\n", name, (unsigned)crc, (double)size * numPasses / t / (1 << 20));
+  if (crc != crcRef || !CheckCrcFunc(func, data, size))
+  {
+    printf("ERROR: %s: wrong CRC\n", name);
+    return 1;
+  }
+  return 0;
+}
+
+static int BenchCrc(int numArgs, char *args[])
+{
+  int sizeMB = numArgs > 0 ? atoi(args[0]) : 16;
+  size_t size = (size_t)sizeMB << 20;
+  Byte *data;
+  UInt32 crc;
+  size_t i;
+  int res = 0;
+
+  if (sizeMB <= 0)
+    return 1;
+  data = (Byte *)malloc(size);
+  if (!data)
+    return 1;
+  for (i = 0; i < size; i++)
+    data[i] = (Byte)(Rand32() >> 24);
+
+  crc = CRC_GET_DIGEST(CrcUpdateT1(CRC_INIT_VAL, data, size, g_CrcTable));
+
+  printf("CRC32 of %u MB\n", (unsigned)(size >> 20));
+  res |= BenchCrcFunc("T1", CrcUpdateT1, data, size, crc);
+  #ifdef MY_CPU_LE
+  res |= BenchCrcFunc("T4", CrcUpdateT4, data, size, crc);
+  res |= BenchCrcFunc("T8", CrcUpdateT8, data, size, crc);
+  res |= BenchCrcFunc("T16", CrcUpdateT16, data, size, crc);
+  #ifdef MY_CPU_X86_OR_AMD64
+  if (CPU_Is_Pclmul_Supported())
+    res |= BenchCrcFunc("PCLMUL", CrcUpdatePclmul, data, size, crc);
+  #endif
+  #ifdef MY_CPU_ARM64
+  if (CPU_Is_Crc32_Supported())
+    res |= BenchCrcFunc("ARM", CrcUpdateArm, data, size, crc);
+  #endif
+  #endif
+  res |= BenchCrcFunc("CrcUpdate", CrcUpdateSelected, data, size, crc);
+  free(data);
+  return res;
+}
+
+/* ---------- Archive generator ---------- */
+
+/* 7z archive in memory: one solid block with Copy method, 'numDirs' directories
+  "dirN" and 'numFiles' files "dirN/fileM.txt" (or "fileM.txt", if 'numDirs==0')
+  of 1-127 bytes, with names, mtime and attributes in uncompressed header */
+
+typedef struct
+{
+  CDynBuf buf;
+  Bool error;
+} COutBuf;
+
+static void OutBuf_Init(COutBuf *p)
+{
+  DynBuf_Construct(&p->buf);
+  p->error = False;
+}
+
+static void OutBuf_Write(COutBuf *p, const void *data, size_t size)
+{
+  if (!DynBuf_Write(&p->buf, (const Byte *)data, size, &g_Alloc))
+    p->error = True;
+}
+
+static void OutBuf_WriteByte(COutBuf *p, Byte b)
+{
+  OutBuf_Write(p, &b, 1);
+}
+
+static void SetUInt64(Byte *p, UInt64 v)
+{
+  SetUi32(p, (UInt32)v);
+  SetUi32(p + 4, (UInt32)(v >> 32));
+}
+
+static void OutBuf_WriteUInt32(COutBuf *p, UInt32 v)
+{
+  Byte b[4];
+  SetUi32(b, v);
+  OutBuf_Write(p, b, 4);
+}
+
+static void OutBuf_WriteUInt64(COutBuf *p, UInt64 v)
+{
+  Byte b[8];
+  SetUInt64(b, v);
+  OutBuf_Write(p, b, 8);
+}
+
+/* 7z NUMBER: the high bits of first byte are the number of next bytes */
+static void OutBuf_WriteNumber(COutBuf *p, UInt64 value)
+{
+  Byte firstByte = 0;
+  Byte mask = 0x80;
+  int i;
+  for (i = 0; i < 8; i++)
+  {
+    if (value < ((UInt64)1 << (7 * (i + 1))))
+    {
+      firstByte |= (Byte)(value >> (8 * i));
+      break;
+    }
+    firstByte |= mask;
+    mask >>= 1;
+  }
+  OutBuf_WriteByte(p, firstByte);
+  for (; i > 0; i--)
+  {
+    OutBuf_WriteByte(p, (Byte)value);
+    value >>= 8;
+  }
+}
+
+/* property of FilesInfo: id, size and data of 'numItems' items, that are defined for all files */
+static void OutBuf_WriteVector(COutBuf *p, Byte id, const COutBuf *data)
+{
+  OutBuf_WriteNumber(p, id);
+  OutBuf_WriteNumber(p, data->buf.pos + 2);
+  OutBuf_WriteByte(p, 1); /* allAreDefined */
+  OutBuf_WriteByte(p, 0); /* external */
+  OutBuf_Write(p, data->buf.data, data->buf.pos);
+}
+
+static void OutBuf_WriteName(COutBuf *p, const char *name)
+{
+  for (;; name++)
+  {
+    OutBuf_WriteByte(p, (Byte)*name);
+    OutBuf_WriteByte(p, 0);
+    if (*name == 0)
+      break;
+  }
+}
+
+#define k7zIdEnd 0x00
+#define k7zIdHeader 0x01
+#define k7zIdMainStreamsInfo 0x04
+#define k7zIdFilesInfo 0x05
+#define k7zIdPackInfo 0x06
+#define k7zIdUnpackInfo 0x07
+#define k7zIdSubStreamsInfo 0x08
+#define k7zIdSize 0x09
+#define k7zIdCRC 0x0A
+#define k7zIdFolder 0x0B
+#define k7zIdCodersUnpackSize 0x0C
+#define k7zIdNumUnpackStream 0x0D
+#define k7zIdEmptyStream 0x0E
+#define k7zIdName 0x11
+#define k7zIdMTime 0x14
+#define k7zIdWinAttributes 0x15
+
+/* the archive is in arc->data, arc->pos bytes */
+static SRes CreateArchive(CDynBuf *arc, UInt32 numDirs, UInt32 numFiles)
+{
+  COutBuf out, hdr, names, times, attribs;
+  UInt32 *sizes = (UInt32 *)malloc((numFiles + 1) * sizeof(UInt32));
+  UInt32 *crcs = (UInt32 *)malloc((numFiles + 1) * sizeof(UInt32));
+  UInt32 numItems = numDirs + numFiles;
+  UInt64 packSize;
+  UInt32 i;
+  Bool error;
+  Byte data[128];
+  char name[64];
+
+  if (!sizes || !crcs || numFiles == 0)
+  {
+    free(sizes);
+    free(crcs);
+    return SZ_ERROR_MEM;
+  }
+
+  OutBuf_Init(&out);
+  OutBuf_Init(&hdr);
+  OutBuf_Init(&names);
+  OutBuf_Init(&times);
+  OutBuf_Init(&attribs);
+
+  memset(data, 0, sizeof(data));
+  OutBuf_Write(&out, data, k7zStartHeaderSize);
+  for (i = 0; i < numFiles; i++)
+  {
+    UInt32 size = 1 + Rand32() % 127;
+    UInt32 k;
+    for (k = 0; k < size; k++)
+      data[k] = (Byte)(Rand32() >> 24);
+    sizes[i] = size;
+    crcs[i] = CrcCalc(data, size);
+    OutBuf_Write(&out, data, size);
+  }
+  packSize = out.buf.pos - k7zStartHeaderSize;
+
+  for (i = 0; i < numItems; i++)
+  {
+    if (i < numDirs)
+      sprintf(name, "dir%u", (unsigned)i);
+    else if (numDirs == 0)
+      sprintf(name, "file%u.txt", (unsigned)i);
+    else
+      sprintf(name, "dir%u/file%u.txt", (unsigned)((i - numDirs) % numDirs), (unsigned)(i - numDirs));
+    OutBuf_WriteName(&names, name);
+    /* FILETIME of 2010-01-01 + i seconds */
+    OutBuf_WriteUInt64(&times, (UInt64)129067776000000000 + (UInt64)i * 10000000);
+    OutBuf_WriteUInt32(&attribs, i < numDirs ? 0x10 : 0x20);
+  }
+
+  OutBuf_WriteByte(&hdr, k7zIdHeader);
+  OutBuf_WriteByte(&hdr, k7zIdMainStreamsInfo);
+
+  OutBuf_WriteByte(&hdr, k7zIdPackInfo);
+  OutBuf_WriteNumber(&hdr, 0); /* packPos */
+  OutBuf_WriteNumber(&hdr, 1); /* numPackStreams */
+  OutBuf_WriteByte(&hdr, k7zIdSize);
+  OutBuf_WriteNumber(&hdr, packSize);
+  OutBuf_WriteByte(&hdr, k7zIdEnd);
+
+  OutBuf_WriteByte(&hdr, k7zIdUnpackInfo);
+  OutBuf_WriteByte(&hdr, k7zIdFolder);
+  OutBuf_WriteNumber(&hdr, 1); /* numFolders */
+  OutBuf_WriteByte(&hdr, 0); /* external */
+  OutBuf_WriteNumber(&hdr, 1); /* numCoders */
+  OutBuf_WriteByte(&hdr, 1); /* simple coder with 1-byte id */
+  OutBuf_WriteByte(&hdr, 0); /* Copy */
+  OutBuf_WriteByte(&hdr, k7zIdCodersUnpackSize);
+  OutBuf_WriteNumber(&hdr, packSize);
+  OutBuf_WriteByte(&hdr, k7zIdEnd);
+
+  OutBuf_WriteByte(&hdr, k7zIdSubStreamsInfo);
+  OutBuf_WriteByte(&hdr, k7zIdNumUnpackStream);
+  OutBuf_WriteNumber(&hdr, numFiles);
+  OutBuf_WriteByte(&hdr, k7zIdSize);
+  for (i = 0; i + 1 < numFiles; i++)
+    OutBuf_WriteNumber(&hdr, sizes[i]);
+  OutBuf_WriteByte(&hdr, k7zIdCRC);
+  OutBuf_WriteByte(&hdr, 1); /* allAreDefined */
+  for (i = 0; i < numFiles; i++)
+    OutBuf_WriteUInt32(&hdr, crcs[i]);
+  OutBuf_WriteByte(&hdr, k7zIdEnd);
+
+  OutBuf_WriteByte(&hdr, k7zIdEnd);
+
+  OutBuf_WriteByte(&hdr, k7zIdFilesInfo);
+  OutBuf_WriteNumber(&hdr, numItems);
+  if (numDirs != 0)
+  {
+    /* the directories are the first items, so the bit vector is 1-bits and 0-bits */
+    OutBuf_WriteByte(&hdr, k7zIdEmptyStream);
+    OutBuf_WriteNumber(&hdr, (numItems + 7) / 8);
+    for (i = 0; i < numItems; i += 8)
+    {
+      Byte b = 0;
+      UInt32 k;
+      for (k = 0; k < 8; k++)
+        if (i + k < numDirs)
+          b |= (Byte)(0x80 >> k);
+      OutBuf_WriteByte(&hdr, b);
+    }
+  }
+  OutBuf_WriteByte(&hdr, k7zIdName);
+  OutBuf_WriteNumber(&hdr, names.buf.pos + 1);
+  OutBuf_WriteByte(&hdr, 0); /* external */
+  OutBuf_Write(&hdr, names.buf.data, names.buf.pos);
+  OutBuf_WriteVector(&hdr, k7zIdMTime, &times);
+  OutBuf_WriteVector(&hdr, k7zIdWinAttributes, &attribs);
+  OutBuf_WriteByte(&hdr, k7zIdEnd);
+
+  OutBuf_WriteByte(&hdr, k7zIdEnd);
+
+  OutBuf_Write(&out, hdr.buf.data, hdr.buf.pos);
+
+  error = (out.error || hdr.error || names.error || times.error || attribs.error);
+  if (!error)
+  {
+    Byte *p = out.buf.data;
+    memcpy(p, k7zSignature, k7zSignatureSize);
+    p[6] = k7zMajorVersion;
+    p[7] = 3;
+    SetUInt64(p + 12, packSize); /* NextHeaderOffset */
+    SetUInt64(p + 20, hdr.buf.pos); /* NextHeaderSize */
+    SetUi32(p + 28, CrcCalc(hdr.buf.data, hdr.buf.pos));
+    SetUi32(p + 8, CrcCalc(p + 12, 20));
+  }
+
+  DynBuf_Free(&hdr.buf, &g_Alloc);
+  DynBuf_Free(&names.buf, &g_Alloc);
+  DynBuf_Free(&times.buf, &g_Alloc);
+  DynBuf_Free(&attribs.buf, &g_Alloc);
+  free(sizes);
+  free(crcs);
+  if (error)
+  {
+    DynBuf_Free(&out.buf, &g_Alloc);
+    return SZ_ERROR_MEM;
+  }
+  *arc = out.buf;
+  return SZ_OK;
+}
+
+/* ---------- Offsets of files ---------- */
+
+static int BenchOffsets(int numArgs, char *args[])
+{
+  int num = numArgs > 0 ? atoi(args[0]) : 100000;
+  CDynBuf arc;
+  CMemInStream stream;
+  CSzArEx db;
+  UInt32 i;
+  UInt64 sum1 = 0, sum2 = 0;
+  UInt32 blockIndex = 0xFFFFFFFF;
+  Byte *outBuffer = 0;
+  size_t outBufferSize = 0;
+  clock_t start;
+  SRes res;
+
+  if (num <= 0)
+    return 1;
+  res = CreateArchive(&arc, 0, (UInt32)num);
+  if (res != SZ_OK)
+    return 1;
+  printf("%u files, archive size %u bytes\n", (unsigned)num, (unsigned)arc.pos);
+
+  MemInStream_Init(&stream, arc.data, arc.pos);
+  SzArEx_Init(&db);
+  start = clock();
+  res = SzArEx_Open(&db, &stream.s, &g_Alloc, &g_AllocTemp);
+  printf("SzArEx_Open                %8.3f s\n", GetSeconds(start));
+
+  if (res == SZ_OK)
+  {
+    /* the offsets as sums of sizes of previous files of the block */
+    start = clock();
+    for (i = 0; i < db.db.NumFiles; i++)
+    {
+      UInt32 folderIndex = db.FileIndexToFolderIndexMap[i];
+      UInt64 offset = 0;
+      UInt32 k;
+      if (folderIndex == (UInt32)-1)
+        continue;
+      for (k = db.FolderStartFileIndex[folderIndex]; k < i; k++)
+        offset += db.db.Files[k].Size;
+      sum1 += offset;
+    }
+    printf("offsets, sums of sizes     %8.3f s\n", GetSeconds(start));
+
+    start = clock();
+    for (i = 0; i < db.db.NumFiles; i++)
+      if (db.FileIndexToFolderIndexMap[i] != (UInt32)-1)
+        sum2 += db.FileUnpackPos[i];
+    printf("offsets, FileUnpackPos     %8.3f s\n", GetSeconds(start));
+    if (sum1 != sum2)
+    {
+      printf("ERROR: wrong offsets\n");
+      res = SZ_ERROR_FAIL;
+    }
+  }
+
+  if (res == SZ_OK)
+  {
+    start = clock();
+    for (i = 0; i < db.db.NumFiles; i++)
+    {
+      size_t offset, outSizeProcessed;
+      res = SzArEx_Extract(&db, &stream.s, i, &blockIndex, &outBuffer, &outBufferSize,
+          &offset, &outSizeProcessed, &g_Alloc, &g_AllocTemp);
+      if (res != SZ_OK)
+        break;
+    }
+    printf("SzArEx_Extract of all files %7.3f s\n", GetSeconds(start));
+    IAlloc_Free(&g_Alloc, outBuffer);
+  }
+
+  SzArEx_Free(&db, &g_Alloc);
+  DynBuf_Free(&arc, &g_Alloc);
+  if (res != SZ_OK)
+  {
+    printf("ERROR: %d\n", res);
+    return 1;
+  }
+  return 0;
+}
+
+/* ---------- Listing ---------- */
+
+#define LIST_NUM_DIRS 1000
+
+static int BenchList(int numArgs, char *args[])
+{
+  int num = numArgs > 0 ? atoi(args[0]) : 1000000;
+  const char *outFile = numArgs > 1 ? args[1] : "/dev/null";
+  CDynBuf arc;
+  C7zArchive *archive;
+  const C7zListEntry *entries;
+  unsigned numEntries;
+  clock_t start;
+  int res;
+
+  if (num <= 0)
+    return 1;
+  if (CreateArchive(&arc, LIST_NUM_DIRS, (UInt32)num) != SZ_OK)
+    return 1;
+  printf("%u files, %u directories, archive size %u bytes\n",
+      (unsigned)num, (unsigned)LIST_NUM_DIRS, (unsigned)arc.pos);
+
+  start = clock();
+  res = Open7zArchiveMem(arc.data, arc.pos, &archive);
+  printf("Open7zArchiveMem           %8.3f s\n", GetSeconds(start));
+  if (res == 0)
+  {
+    start = clock();
+    res = Get7zListEntries(archive, &entries, &numEntries);
+    printf("Get7zListEntries           %8.3f s\n", GetSeconds(start));
+    if (res == 0 && numEntries != (unsigned)num + LIST_NUM_DIRS)
+      res = SZ_ERROR_FAIL;
+    if (res == 0)
+    {
+      start = clock();
+      res = Write7zList(archive, outFile, LIST7Z_FORMAT_TSV);
+      printf("Write7zList TSV            %8.3f s\n", GetSeconds(start));
+    }
+    if (res == 0)
+    {
+      start = clock();
+      res = Write7zList(archive, outFile, LIST7Z_FORMAT_JSON);
+      printf("Write7zList JSON           %8.3f s\n", GetSeconds(start));
+    }
+    Close7zArchive(archive);
+  }
+  DynBuf_Free(&arc, &g_Alloc);
+  if (res != 0)
+  {
+    printf("ERROR: %d\n", res);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int numArgs, char *args[])
+{
+  if (numArgs >= 2 && strcmp(args[1], "crc") == 0)
+  {
+    CrcGenerateTable();
+    return BenchCrc(numArgs - 2, args + 2);
+  }
+  if (numArgs >= 2 && strcmp(args[1], "offsets") == 0)
+  {
+    CrcGenerateTable();
+    return BenchOffsets(numArgs - 2, args + 2);
+  }
+  if (numArgs >= 2 && strcmp(args[1], "list") == 0)
+  {
+    CrcGenerateTable();
+    return BenchList(numArgs - 2, args + 2);
+  }
+  printf("Usage: bench crc [sizeMB]\n"
+      "       bench offsets [numFiles]\n"
+      "       bench list [numFiles [outFile]]\n");
+  return 1;
+}
@@ -1,203 +1,403 @@
-/* 7z.h -- 7z interface
-2010-03-11 : Igor Pavlov : Public domain */
-
-#ifndef __7Z_H
-#define __7Z_H
-
-#include "7zBuf.h"
-
-EXTERN_C_BEGIN
-
-#define k7zStartHeaderSize 0x20
-#define k7zSignatureSize 6
-extern Byte k7zSignature[k7zSignatureSize];
-#define k7zMajorVersion 0
-
-enum EIdEnum
-{
-  k7zIdEnd,
-  k7zIdHeader,
-  k7zIdArchiveProperties,
-  k7zIdAdditionalStreamsInfo,
-  k7zIdMainStreamsInfo,
-  k7zIdFilesInfo,
-  k7zIdPackInfo,
-  k7zIdUnpackInfo,
-  k7zIdSubStreamsInfo,
-  k7zIdSize,
-  k7zIdCRC,
-  k7zIdFolder,
-  k7zIdCodersUnpackSize,
-  k7zIdNumUnpackStream,
-  k7zIdEmptyStream,
-  k7zIdEmptyFile,
-  k7zIdAnti,
-  k7zIdName,
-  k7zIdCTime,
-  k7zIdATime,
-  k7zIdMTime,
-  k7zIdWinAttributes,
-  k7zIdComment,
-  k7zIdEncodedHeader,
-  k7zIdStartPos,
-  k7zIdDummy
-};
-
-typedef struct
-{
-  UInt32 NumInStreams;
-  UInt32 NumOutStreams;
-  UInt64 MethodID;
-  CBuf Props;
-} CSzCoderInfo;
-
-void SzCoderInfo_Init(CSzCoderInfo *p);
-void SzCoderInfo_Free(CSzCoderInfo *p, ISzAlloc *alloc);
-
-typedef struct
-{
-  UInt32 InIndex;
-  UInt32 OutIndex;
-} CSzBindPair;
-
-typedef struct
-{
-  CSzCoderInfo *Coders;
-  CSzBindPair *BindPairs;
-  UInt32 *PackStreams;
-  UInt64 *UnpackSizes;
-  UInt32 NumCoders;
-  UInt32 NumBindPairs;
-  UInt32 NumPackStreams;
-  int UnpackCRCDefined;
-  UInt32 UnpackCRC;
-
-  UInt32 NumUnpackStreams;
-} CSzFolder;
-
-void SzFolder_Init(CSzFolder *p);
-UInt64 SzFolder_GetUnpackSize(CSzFolder *p);
-int SzFolder_FindBindPairForInStream(CSzFolder *p, UInt32 inStreamIndex);
-UInt32 SzFolder_GetNumOutStreams(CSzFolder *p);
-UInt64 SzFolder_GetUnpackSize(CSzFolder *p);
-
-SRes SzFolder_Decode(const CSzFolder *folder, const UInt64 *packSizes,
-    ILookInStream *stream, UInt64 startPos,
-    Byte *outBuffer, size_t outSize, ISzAlloc *allocMain);
-
-typedef struct
-{
-  UInt32 Low;
-  UInt32 High;
-} CNtfsFileTime;
-
-typedef struct
-{
-  CNtfsFileTime MTime;
-  UInt64 Size;
-  UInt32 Crc;
-  UInt32 Attrib;
-  Byte HasStream;
-  Byte IsDir;
-  Byte IsAnti;
-  Byte CrcDefined;
-  Byte MTimeDefined;
-  Byte AttribDefined;
-} CSzFileItem;
-
-void SzFile_Init(CSzFileItem *p);
-
-typedef struct
-{
-  UInt64 *PackSizes;
-  Byte *PackCRCsDefined;
-  UInt32 *PackCRCs;
-  CSzFolder *Folders;
-  CSzFileItem *Files;
-  UInt32 NumPackStreams;
-  UInt32 NumFolders;
-  UInt32 NumFiles;
-} CSzAr;
-
-void SzAr_Init(CSzAr *p);
-void SzAr_Free(CSzAr *p, ISzAlloc *alloc);
-
-
-/*
-  SzExtract extracts file from archive
-
-  *outBuffer must be 0 before first call for each new archive.
-
-  Extracting cache:
-    If you need to decompress more than one file, you can send
-    these values from previous call:
-      *blockIndex,
-      *outBuffer,
-      *outBufferSize
-    You can consider "*outBuffer" as cache of solid block. If your archive is solid,
-    it will increase decompression speed.
-  
-    If you use external function, you can declare these 3 cache variables
-    (blockIndex, outBuffer, outBufferSize) as static in that external function.
-    
-    Free *outBuffer and set *outBuffer to 0, if you want to flush cache.
-*/
-
-typedef struct
-{
-  CSzAr db;
-  
-  UInt64 startPosAfterHeader;
-  UInt64 dataPos;
-
-  UInt32 *FolderStartPackStreamIndex;
-  UInt64 *PackStreamStartPositions;
-  UInt32 *FolderStartFileIndex;
-  UInt32 *FileIndexToFolderIndexMap;
-
-  size_t *FileNameOffsets; /* in 2-byte steps */
-  CBuf FileNames;  /* UTF-16-LE */
-} CSzArEx;
-
-void SzArEx_Init(CSzArEx *p);
-void SzArEx_Free(CSzArEx *p, ISzAlloc *alloc);
-UInt64 SzArEx_GetFolderStreamPos(const CSzArEx *p, UInt32 folderIndex, UInt32 indexInFolder);
-int SzArEx_GetFolderFullPackSize(const CSzArEx *p, UInt32 folderIndex, UInt64 *resSize);
-
-/*
-if dest == NULL, the return value specifies the required size of the buffer,
-  in 16-bit characters, including the null-terminating character.
-if dest != NULL, the return value specifies the number of 16-bit characters that
-  are written to the dest, including the null-terminating character. */
-
-size_t SzArEx_GetFileNameUtf16(const CSzArEx *p, size_t fileIndex, UInt16 *dest);
-
-SRes SzArEx_Extract(
-    const CSzArEx *db,
-    ILookInStream *inStream,
-    UInt32 fileIndex,         /* index of file */
-    UInt32 *blockIndex,       /* index of solid block */
-    Byte **outBuffer,         /* pointer to pointer to output buffer (allocated with allocMain) */
-    size_t *outBufferSize,    /* buffer size for output buffer */
-    size_t *offset,           /* offset of stream for required file in *outBuffer */
-    size_t *outSizeProcessed, /* size of file in *outBuffer */
-    ISzAlloc *allocMain,
-    ISzAlloc *allocTemp);
-
-
-/*
-SzArEx_Open Errors:
-SZ_ERROR_NO_ARCHIVE
-SZ_ERROR_ARCHIVE
-SZ_ERROR_UNSUPPORTED
-SZ_ERROR_MEM
-SZ_ERROR_CRC
-SZ_ERROR_INPUT_EOF
-SZ_ERROR_FAIL
-*/
-
-SRes SzArEx_Open(CSzArEx *p, ILookInStream *inStream, ISzAlloc *allocMain, ISzAlloc *allocTemp);
-
-EXTERN_C_END
-
-#endif
+/* 7z.h -- 7z interface
+2010-03-11 : Igor Pavlov : Public domain */
+
+#ifndef __7Z_H
+#define __7Z_H
+
+#include "7zBuf.h"
+
+EXTERN_C_BEGIN
+
+#define k7zStartHeaderSize 0x20
+#define k7zSignatureSize 6
+extern Byte k7zSignature[k7zSignatureSize];
+#define k7zMajorVersion 0
+
+enum EIdEnum
+{
+  k7zIdEnd,
+  k7zIdHeader,
+  k7zIdArchiveProperties,
+  k7zIdAdditionalStreamsInfo,
+  k7zIdMainStreamsInfo,
+  k7zIdFilesInfo,
+  k7zIdPackInfo,
+  k7zIdUnpackInfo,
+  k7zIdSubStreamsInfo,
+  k7zIdSize,
+  k7zIdCRC,
+  k7zIdFolder,
+  k7zIdCodersUnpackSize,
+  k7zIdNumUnpackStream,
+  k7zIdEmptyStream,
+  k7zIdEmptyFile,
+  k7zIdAnti,
+  k7zIdName,
+  k7zIdCTime,
+  k7zIdATime,
+  k7zIdMTime,
+  k7zIdWinAttributes,
+  k7zIdComment,
+  k7zIdEncodedHeader,
+  k7zIdStartPos,
+  k7zIdDummy
+};
+
+typedef struct
+{
+  UInt32 NumInStreams;
+  UInt32 NumOutStreams;
+  UInt64 MethodID;
+  CBuf Props;
+} CSzCoderInfo;
+
+void SzCoderInfo_Init(CSzCoderInfo *p);
+void SzCoderInfo_Free(CSzCoderInfo *p, ISzAlloc *alloc);
+
+typedef struct
+{
+  UInt32 InIndex;
+  UInt32 OutIndex;
+} CSzBindPair;
+
+typedef struct
+{
+  CSzCoderInfo *Coders;
+  CSzBindPair *BindPairs;
+  UInt32 *PackStreams;
+  UInt64 *UnpackSizes;
+  UInt32 NumCoders;
+  UInt32 NumBindPairs;
+  UInt32 NumPackStreams;
+  int UnpackCRCDefined;
+  UInt32 UnpackCRC;
+
+  UInt32 NumUnpackStreams;
+} CSzFolder;
+
+void SzFolder_Init(CSzFolder *p);
+UInt64 SzFolder_GetUnpackSize(CSzFolder *p);
+int SzFolder_FindBindPairForInStream(CSzFolder *p, UInt32 inStreamIndex);
+UInt32 SzFolder_GetNumOutStreams(CSzFolder *p);
+UInt64 SzFolder_GetUnpackSize(CSzFolder *p);
+
+SRes SzFolder_Decode(const CSzFolder *folder, const UInt64 *packSizes,
+    ILookInStream *stream, UInt64 startPos,
+    Byte *outBuffer, size_t outSize, ISzAlloc *allocMain);
+
+/*
+SzFolder_DecodeCrc is same as SzFolder_Decode, but it also calculates CRC of
+the unpacked data (*crc) and CRC of its part [rangeOffset, rangeOffset + rangeSize)
+(*rangeCrc) on each decoded chunk, so there is no second pass over outBuffer.
+*/
+SRes SzFolder_DecodeCrc(const CSzFolder *folder, const UInt64 *packSizes,
+    ILookInStream *stream, UInt64 startPos,
+    Byte *outBuffer, size_t outSize, ISzAlloc *allocMain,
+    size_t rangeOffset, size_t rangeSize, UInt32 *crc, UInt32 *rangeCrc);
+
+/*
+SzDec_SetNumThreads sets the number of threads that SzFolder_Decode uses
+for LZMA2 streams with dictionary resets (1 by default). With more than one
+thread the packed stream is read to memory, and parts of it after each reset
+are decoded in parallel. Call it before decoding, not during it.
+*/
+void SzDec_SetNumThreads(UInt32 numThreads);
+
+/*
+SzFolder_DecodeToStream decodes folder through the dictionary-sized window
+  and writes unpacked data to outStream as soon as it is decoded.
+  Only Copy, LZMA and LZMA2 folders (with optional BCJ filter) can be decoded that way.
+  For other folders it returns SZ_ERROR_UNSUPPORTED without writing anything.
+*/
+
+Bool SzFolder_CanDecodeToStream(const CSzFolder *folder);
+SRes SzFolder_DecodeToStream(const CSzFolder *folder, const UInt64 *packSizes,
+    ILookInStream *stream, UInt64 startPos,
+    ISeqOutStream *outStream, ISzAlloc *allocMain);
+
+typedef struct
+{
+  UInt32 Low;
+  UInt32 High;
+} CNtfsFileTime;
+
+typedef struct
+{
+  CNtfsFileTime MTime;
+  UInt64 Size;
+  UInt32 Crc;
+  UInt32 Attrib;
+  Byte HasStream;
+  Byte IsDir;
+  Byte IsAnti;
+  Byte CrcDefined;
+  Byte MTimeDefined;
+  Byte AttribDefined;
+} CSzFileItem;
+
+void SzFile_Init(CSzFileItem *p);
+
+typedef struct
+{
+  UInt64 *PackSizes;
+  Byte *PackCRCsDefined;
+  UInt32 *PackCRCs;
+  CSzFolder *Folders;
+  CSzFileItem *Files;
+  UInt32 NumPackStreams;
+  UInt32 NumFolders;
+  UInt32 NumFiles;
+} CSzAr;
+
+void SzAr_Init(CSzAr *p);
+void SzAr_Free(CSzAr *p, ISzAlloc *alloc);
+
+
+/*
+  SzExtract extracts file from archive
+
+  *outBuffer must be 0 before first call for each new archive.
+
+  Extracting cache:
+    If you need to decompress more than one file, you can send
+    these values from previous call:
+      *blockIndex,
+      *outBuffer,
+      *outBufferSize
+    You can consider "*outBuffer" as cache of solid block. If your archive is solid,
+    it will increase decompression speed.
+  
+    If you use external function, you can declare these 3 cache variables
+    (blockIndex, outBuffer, outBufferSize) as static in that external function.
+    
+    Free *outBuffer and set *outBuffer to 0, if you want to flush cache.
+
+  Solid block is decoded only up to the end of required file, if it's possible
+  (Copy, LZMA and LZMA2 folders with optional BCJ filter). *outBufferSize is the size
+  of decoded part then, and whole block is decoded again for the file after that part.
+  CRC of solid block is checked only when whole block is decoded (CRC of file is always checked).
+*/
+
+typedef struct
+{
+  CSzAr db;
+  
+  UInt64 startPosAfterHeader;
+  UInt64 dataPos;
+
+  UInt32 *FolderStartPackStreamIndex;
+  UInt64 *PackStreamStartPositions;
+  UInt32 *FolderStartFileIndex;
+  UInt32 *FileIndexToFolderIndexMap;
+  UInt64 *FileUnpackPos; /* offset of file in unpacked data of its folder */
+
+  size_t *FileNameOffsets; /* in 2-byte steps */
+  CBuf FileNames;  /* UTF-16-LE */
+
+  /* hash tables of file names for SzArEx_FindFile: (file index + 1) or 0 for empty slot.
+    The slot keeps the first file of the name, the next files with the same name
+    are linked in NameNext / BaseNameNext: (file index + 1) or 0 for the last one */
+  UInt32 *NameHash;     /* full names */
+  UInt32 *BaseNameHash; /* names without directories */
+  UInt32 *NameNext;
+  UInt32 *BaseNameNext;
+  UInt32 *NameHashes;     /* hashes of names of files */
+  UInt32 *BaseNameHashes;
+  UInt32 NameHashMask;
+
+  /* UTF-8 names, that are built by SzArEx_OpenEx with SZ_AR_OPEN_UTF8_NAMES:
+    null-terminated names follow each other in Utf8Names */
+  size_t *Utf8NameOffsets;
+  CBuf Utf8Names;
+
+  /* SZ_AR_OPEN_LAZY: the header, that is kept after SzArEx_OpenEx, and the data of
+    the properties in that header, that are read later by SzArEx_Load */
+  CBuf Header;
+  Byte *LazyNames;
+  size_t LazyNamesSize;
+  Byte *LazyMTime;
+  size_t LazyMTimeSize;
+  Byte *LazyAttrib;
+  size_t LazyAttribSize;
+  unsigned NotLoaded; /* SZ_AR_LOAD_* flags of the data, that is not loaded yet */
+
+  /* SzArEx_OpenIndex: the memory of index, the tables point to it */
+  const Byte *Index;
+} CSzArEx;
+
+void SzArEx_Init(CSzArEx *p);
+void SzArEx_Free(CSzArEx *p, ISzAlloc *alloc);
+UInt64 SzArEx_GetFolderStreamPos(const CSzArEx *p, UInt32 folderIndex, UInt32 indexInFolder);
+int SzArEx_GetFolderFullPackSize(const CSzArEx *p, UInt32 folderIndex, UInt64 *resSize);
+
+/*
+if dest == NULL, the return value specifies the required size of the buffer,
+  in 16-bit characters, including the null-terminating character.
+if dest != NULL, the return value specifies the number of 16-bit characters that
+  are written to the dest, including the null-terminating character. */
+
+size_t SzArEx_GetFileNameUtf16(const CSzArEx *p, size_t fileIndex, UInt16 *dest);
+
+/*
+SzArEx_GetFileNameUtf8 returns the null-terminated UTF-8 name of file from the table
+  and its length in bytes without null-terminating character in *len,
+  or NULL, if the table was not built by SzArEx_OpenEx or SzArEx_Load.
+*/
+
+const char *SzArEx_GetFileNameUtf8(const CSzArEx *p, size_t fileIndex, size_t *len);
+
+/*
+SzArEx_FindFile returns index of the first file (starting from startIndex) with
+  the name (UTF-16 string of len characters without null-terminating character),
+  or (UInt32)-1, if there is no such file.
+  If (baseName != 0), the name is compared with the names of files without directories.
+The lookup uses hash tables that are built by SzArEx_Open (or by SzArEx_Load
+  after SzArEx_OpenEx with SZ_AR_OPEN_LAZY).
+*/
+
+UInt32 SzArEx_FindFile(const CSzArEx *p, const UInt16 *name, size_t len, int baseName, UInt32 startIndex);
+
+SRes SzArEx_Extract(
+    const CSzArEx *db,
+    ILookInStream *inStream,
+    UInt32 fileIndex,         /* index of file */
+    UInt32 *blockIndex,       /* index of solid block */
+    Byte **outBuffer,         /* pointer to pointer to output buffer (allocated with allocMain) */
+    size_t *outBufferSize,    /* buffer size for output buffer */
+    size_t *offset,           /* offset of stream for required file in *outBuffer */
+    size_t *outSizeProcessed, /* size of file in *outBuffer */
+    ISzAlloc *allocMain,
+    ISzAlloc *allocTemp);
+
+
+/*
+  SzArEx_ExtractFolder extracts all files of solid block without
+  allocating the buffer for the whole block: it decodes the folder through
+  the dictionary-sized window and writes the data of each file to the stream
+  returned by GetStream as soon as that data is decoded.
+  So memory usage is about dictionary size instead of solid block size.
+
+  GetStream can return NULL, if the data of that file is not required.
+  SetResult is called after the last byte of each file (res is SZ_OK or SZ_ERROR_CRC).
+  If SetResult returns error, extraction is stopped with that error.
+
+  Folders that can't be decoded to stream (BCJ2, PPMd) are decoded to
+  temporary buffer of folder's size, and then they are written the same way.
+*/
+
+typedef struct
+{
+  ISeqOutStream *(*GetStream)(void *p, UInt32 fileIndex);
+  SRes (*SetResult)(void *p, UInt32 fileIndex, SRes res);
+} ISzExtractCallback;
+
+SRes SzArEx_ExtractFolder(
+    const CSzArEx *db,
+    ILookInStream *inStream,
+    UInt32 folderIndex,
+    ISzExtractCallback *callback,
+    ISzAlloc *allocTemp);
+
+/*
+  SzArEx_ExtractFolderPart is same as SzArEx_ExtractFolder, but decoding is
+  stopped after SetResult of the file lastFileIndex, so the files after it
+  are not decoded. CRC of the folder is not checked in that case (CRCs of files are).
+*/
+
+SRes SzArEx_ExtractFolderPart(
+    const CSzArEx *db,
+    ILookInStream *inStream,
+    UInt32 folderIndex,
+    UInt32 lastFileIndex,
+    ISzExtractCallback *callback,
+    ISzAlloc *allocTemp);
+
+
+/*
+SzArEx_Open Errors:
+SZ_ERROR_NO_ARCHIVE
+SZ_ERROR_ARCHIVE
+SZ_ERROR_UNSUPPORTED
+SZ_ERROR_MEM
+SZ_ERROR_CRC
+SZ_ERROR_INPUT_EOF
+SZ_ERROR_FAIL
+*/
+
+SRes SzArEx_Open(CSzArEx *p, ILookInStream *inStream, ISzAlloc *allocMain, ISzAlloc *allocTemp);
+
+/*
+SzArEx_OpenEx is same as SzArEx_Open with additional flags:
+  SZ_AR_OPEN_UTF8_NAMES - the table of UTF-8 names is built for SzArEx_GetFileNameUtf8.
+    Single surrogates of names are converted as other 16-bit characters.
+  SZ_AR_OPEN_LAZY - the names, the modification times and the attributes of files
+    are not read, and the hash tables of names are not built. The header is kept
+    in memory allocated with allocMain, and the names are used from it in place.
+    SzArEx_Load must be called before the use of that data.
+*/
+
+#define SZ_AR_OPEN_UTF8_NAMES 1
+#define SZ_AR_OPEN_LAZY       2
+
+SRes SzArEx_OpenEx(CSzArEx *p, ILookInStream *inStream, unsigned flags, ISzAlloc *allocMain, ISzAlloc *allocTemp);
+
+/*
+SzArEx_Load reads the data of archive, that was not read by SzArEx_OpenEx:
+  SZ_AR_LOAD_NAMES - FileNameOffsets and FileNames for SzArEx_GetFileNameUtf16
+  SZ_AR_LOAD_NAME_HASH - the hash tables for SzArEx_FindFile
+  SZ_AR_LOAD_UTF8_NAMES - the table for SzArEx_GetFileNameUtf8
+  SZ_AR_LOAD_MTIME - MTime and MTimeDefined of files
+  SZ_AR_LOAD_ATTRIB - Attrib and AttribDefined of files
+SZ_AR_LOAD_NAME_HASH and SZ_AR_LOAD_UTF8_NAMES also load the names.
+The data that is loaded already is not loaded again, so SzArEx_Load can be called
+  before each use of that data. It also can be called after SzArEx_Open.
+If SzArEx_Load fails, the data of that call, that is not loaded, stays unloaded,
+  and the archive still can be used for other data.
+SzArEx_Load changes CSzArEx, so it can't be called, if the archive is used in other threads.
+
+Errors:
+SZ_ERROR_ARCHIVE
+SZ_ERROR_MEM
+*/
+
+#define SZ_AR_LOAD_NAMES      (1 << 0)
+#define SZ_AR_LOAD_NAME_HASH  (1 << 1)
+#define SZ_AR_LOAD_UTF8_NAMES (1 << 2)
+#define SZ_AR_LOAD_MTIME      (1 << 3)
+#define SZ_AR_LOAD_ATTRIB     (1 << 4)
+
+SRes SzArEx_Load(CSzArEx *p, unsigned props, ISzAlloc *allocMain, ISzAlloc *allocTemp);
+
+/*
+The index of archive is the parsed header of archive (the tables of CSzArEx) in
+  flat form, so the archive can be opened from the index without reading, decoding
+  and parsing of its header. The index can be used only by the same build of library.
+
+SzArEx_WriteIndex writes the index of the opened archive to outStream.
+  All data must be loaded (SzArEx_Load with all SZ_AR_LOAD_* flags).
+  key (keySize bytes) is the data of caller that identifies the archive
+  (for example, the name, the size and the time of archive file).
+
+SzArEx_OpenIndex opens the archive from the index in memory (usually it's the
+  mapped file of index): the tables of p point to that memory, so it must stay
+  valid and unchanged until SzArEx_Free. Only the folders are allocated with allocMain.
+  The sizes of tables and all indexes and offsets in the tables are checked, so the
+  damaged index can't cause the access out of its tables. The other data (sizes of files,
+  CRCs, times) is used as it is, like the same data of archive header.
+
+Errors:
+SZ_ERROR_NO_ARCHIVE - it's not index, it's the index of other build or with other key
+SZ_ERROR_CRC        - the header of index is damaged
+SZ_ERROR_ARCHIVE    - the tables of index are damaged
+SZ_ERROR_MEM
+SZ_ERROR_PARAM      - SzArEx_WriteIndex: the data of archive is not loaded
+SZ_ERROR_WRITE      - SzArEx_WriteIndex: the error of outStream
+*/
+
+SRes SzArEx_WriteIndex(const CSzArEx *p, const void *key, size_t keySize, ISeqOutStream *outStream);
+SRes SzArEx_OpenIndex(CSzArEx *p, const void *data, size_t size,
+    const void *key, size_t keySize, ISzAlloc *allocMain);
+
+EXTERN_C_END
+
+#endif
@@ -1,34 +1,240 @@
-/* 7zCrcOpt.c -- CRC32 calculation : optimized version
-2009-11-23 : Igor Pavlov : Public domain */
-
-#include "CpuArch.h"
-
-#ifdef MY_CPU_LE
-
-#define CRC_UPDATE_BYTE_2(crc, b) (table[((crc) ^ (b)) & 0xFF] ^ ((crc) >> 8))
-
-UInt32 MY_FAST_CALL CrcUpdateT4(UInt32 v, const void *data, size_t size, const UInt32 *table)
-{
-  const Byte *p = (const Byte *)data;
-  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 3) != 0; size--, p++)
-    v = CRC_UPDATE_BYTE_2(v, *p);
-  for (; size >= 4; size -= 4, p += 4)
-  {
-    v ^= *(const UInt32 *)p;
-    v =
-      table[0x300 + (v & 0xFF)] ^
-      table[0x200 + ((v >> 8) & 0xFF)] ^
-      table[0x100 + ((v >> 16) & 0xFF)] ^
-      table[0x000 + ((v >> 24))];
-  }
-  for (; size > 0; size--, p++)
-    v = CRC_UPDATE_BYTE_2(v, *p);
-  return v;
-}
-
-UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const UInt32 *table)
-{
-  return CrcUpdateT4(v, data, size, table);
-}
-
-#endif
+/* 7zCrcOpt.c -- CRC32 calculation : optimized version
+2009-11-23 : Igor Pavlov : Public domain */
+
+#include "CpuArch.h"
+
+#ifdef MY_CPU_LE
+
+#define CRC_UPDATE_BYTE_2(crc, b) (table[((crc) ^ (b)) & 0xFF] ^ ((crc) >> 8))
+
+/* table[k * 0x100 + b] is CRC of byte (b) followed by (k) zero bytes */
+#define CRC_SLICE_4(w, k) ( \
+    table[(k) + 0x300 + ((w) & 0xFF)] ^ \
+    table[(k) + 0x200 + (((w) >> 8) & 0xFF)] ^ \
+    table[(k) + 0x100 + (((w) >> 16) & 0xFF)] ^ \
+    table[(k) + 0x000 + ((w) >> 24)])
+
+UInt32 MY_FAST_CALL CrcUpdateT4(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 3) != 0; size--, p++)
+    v = CRC_UPDATE_BYTE_2(v, *p);
+  for (; size >= 4; size -= 4, p += 4)
+  {
+    v ^= *(const UInt32 *)p;
+    v =
+      table[0x300 + (v & 0xFF)] ^
+      table[0x200 + ((v >> 8) & 0xFF)] ^
+      table[0x100 + ((v >> 16) & 0xFF)] ^
+      table[0x000 + ((v >> 24))];
+  }
+  for (; size > 0; size--, p++)
+    v = CRC_UPDATE_BYTE_2(v, *p);
+  return v;
+}
+
+UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 7) != 0; size--, p++)
+    v = CRC_UPDATE_BYTE_2(v, *p);
+  for (; size >= 8; size -= 8, p += 8)
+  {
+    UInt32 d = ((const UInt32 *)p)[1];
+    v ^= ((const UInt32 *)p)[0];
+    v = CRC_SLICE_4(v, 0x400) ^ CRC_SLICE_4(d, 0);
+  }
+  for (; size > 0; size--, p++)
+    v = CRC_UPDATE_BYTE_2(v, *p);
+  return v;
+}
+
+UInt32 MY_FAST_CALL CrcUpdateT16(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 7) != 0; size--, p++)
+    v = CRC_UPDATE_BYTE_2(v, *p);
+  for (; size >= 16; size -= 16, p += 16)
+  {
+    UInt32 d1 = ((const UInt32 *)p)[1];
+    UInt32 d2 = ((const UInt32 *)p)[2];
+    UInt32 d3 = ((const UInt32 *)p)[3];
+    v ^= ((const UInt32 *)p)[0];
+    v = CRC_SLICE_4(v, 0xC00) ^ CRC_SLICE_4(d1, 0x800) ^ CRC_SLICE_4(d2, 0x400) ^ CRC_SLICE_4(d3, 0);
+  }
+  return CrcUpdateT8(v, p, size, table);
+}
+
+#endif
+
+
+/* ---------- CRC with CPU instructions ---------- */
+
+/*
+These functions are selected by CrcGenerateTable, if CPU supports the instructions.
+If compiler can't generate the instructions, they use the tables instead.
+*/
+
+#ifdef MY_CPU_X86_OR_AMD64
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1500)
+#define USE_CRC_PCLMUL
+#define CRC_PCLMUL_ATTRIB
+#elif defined(__clang__) && (__clang_major__ >= 4) || \
+    defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define USE_CRC_PCLMUL
+#define CRC_PCLMUL_ATTRIB __attribute__((target("sse2,pclmul")))
+#endif
+
+#ifdef USE_CRC_PCLMUL
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+/*
+Folding with carry-less multiplication: V. Gopal et al., "Fast CRC Computation
+for Generic Polynomials Using PCLMULQDQ Instruction", Intel, 2009.
+The constants are powers of x modulo bit-reflected CRC-32 polynomial.
+(size) must be a multiple of 16 and not less than 64.
+*/
+
+static CRC_PCLMUL_ATTRIB UInt32 CrcUpdatePclmul2(UInt32 v, const Byte *p, size_t size)
+{
+  const __m128i k1k2 = _mm_setr_epi32(0x54442BD4, 1, 0xC6E41596, 1);
+  const __m128i k3k4 = _mm_setr_epi32(0x751997D0, 1, 0xCCAA009E, 0);
+  const __m128i k5 = _mm_setr_epi32(0x63CD6124, 1, 0, 0);
+  const __m128i poly = _mm_setr_epi32(0xDB710641, 1, 0xF7011641, 1);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + 0x00)), _mm_cvtsi32_si128((int)v));
+  x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+  p += 64;
+  size -= 64;
+
+  /* folding 4 x 128 bits in parallel */
+  for (; size >= 64; size -= 64, p += 64)
+  {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 0x30)));
+  }
+
+  /* folding to 128 bits */
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  for (; size >= 16; size -= 16, p += 16)
+  {
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)p)), x5);
+  }
+
+  /* folding 128 bits to 64 bits */
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5, 0x00), x2);
+
+  /* Barrett reduction to 32 bits */
+  x0 = _mm_and_si128(x1, mask32);
+  x0 = _mm_clmulepi64_si128(x0, poly, 0x10);
+  x0 = _mm_and_si128(x0, mask32);
+  x0 = _mm_clmulepi64_si128(x0, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x0);
+  return (UInt32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+#endif
+
+UInt32 MY_FAST_CALL CrcUpdatePclmul(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  #ifdef USE_CRC_PCLMUL
+  if (size >= 64)
+  {
+    size_t size2 = size & ~(size_t)15;
+    v = CrcUpdatePclmul2(v, (const Byte *)data, size2);
+    data = (const Byte *)data + size2;
+    size -= size2;
+  }
+  #endif
+  return CrcUpdateT8(v, data, size, table);
+}
+
+#endif
+
+#if defined(MY_CPU_ARM64) && defined(MY_CPU_LE)
+
+#if defined(_MSC_VER)
+#define USE_CRC_ARM
+#define CRC_ARM_ATTRIB
+#include <intrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define USE_CRC_ARM
+#define CRC_ARM_ATTRIB
+#include <arm_acle.h>
+#elif defined(__clang__) && (__clang_major__ >= 4)
+#define USE_CRC_ARM
+#define CRC_ARM_ATTRIB __attribute__((target("crc")))
+#include <arm_acle.h>
+#elif defined(__GNUC__) && (__GNUC__ >= 6)
+#define USE_CRC_ARM
+#define CRC_ARM_ATTRIB __attribute__((target("+crc")))
+#include <arm_acle.h>
+#endif
+
+#ifdef USE_CRC_ARM
+
+/* CRC32 instructions of ARMv8 use the same bit-reflected polynomial and don't invert CRC */
+
+static CRC_ARM_ATTRIB UInt32 CrcUpdateArm2(UInt32 v, const Byte *p, size_t size)
+{
+  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 7) != 0; size--, p++)
+    v = __crc32b(v, *p);
+  for (; size >= 32; size -= 32, p += 32)
+  {
+    v = __crc32d(v, ((const UInt64 *)p)[0]);
+    v = __crc32d(v, ((const UInt64 *)p)[1]);
+    v = __crc32d(v, ((const UInt64 *)p)[2]);
+    v = __crc32d(v, ((const UInt64 *)p)[3]);
+  }
+  for (; size >= 8; size -= 8, p += 8)
+    v = __crc32d(v, *(const UInt64 *)p);
+  for (; size > 0; size--, p++)
+    v = __crc32b(v, *p);
+  return v;
+}
+
+#endif
+
+UInt32 MY_FAST_CALL CrcUpdateArm(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  #ifdef USE_CRC_ARM
+  table = table;
+  return CrcUpdateArm2(v, (const Byte *)data, size);
+  #else
+  return CrcUpdateT8(v, data, size, table);
+  #endif
+}
+
+#endif
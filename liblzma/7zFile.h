@@ -1,83 +1,134 @@
-/* 7zFile.h -- File IO
-2009-11-24 : Igor Pavlov : Public domain */
-
-#ifndef __7Z_FILE_H
-#define __7Z_FILE_H
-
-#ifdef _WIN32
-#define USE_WINDOWS_FILE
-#endif
-
-#ifdef USE_WINDOWS_FILE
-#include <windows.h>
-#else
-#include <stdio.h>
-#endif
-
-#include "Types.h"
-
-EXTERN_C_BEGIN
-
-/* ---------- File ---------- */
-
-typedef struct
-{
-  #ifdef USE_WINDOWS_FILE
-  HANDLE handle;
-  #else
-  FILE *file;
-  #endif
-} CSzFile;
-
-void File_Construct(CSzFile *p);
-#if !defined(UNDER_CE) || !defined(USE_WINDOWS_FILE)
-WRes InFile_Open(CSzFile *p, const char *name);
-WRes OutFile_Open(CSzFile *p, const char *name);
-#endif
-#ifdef USE_WINDOWS_FILE
-WRes InFile_OpenW(CSzFile *p, const WCHAR *name);
-WRes OutFile_OpenW(CSzFile *p, const WCHAR *name);
-#endif
-WRes File_Close(CSzFile *p);
-
-/* reads max(*size, remain file's size) bytes */
-WRes File_Read(CSzFile *p, void *data, size_t *size);
-
-/* writes *size bytes */
-WRes File_Write(CSzFile *p, const void *data, size_t *size);
-
-WRes File_Seek(CSzFile *p, Int64 *pos, ESzSeek origin);
-WRes File_GetLength(CSzFile *p, UInt64 *length);
-
-
-/* ---------- FileInStream ---------- */
-
-typedef struct
-{
-  ISeqInStream s;
-  CSzFile file;
-} CFileSeqInStream;
-
-void FileSeqInStream_CreateVTable(CFileSeqInStream *p);
-
-
-typedef struct
-{
-  ISeekInStream s;
-  CSzFile file;
-} CFileInStream;
-
-void FileInStream_CreateVTable(CFileInStream *p);
-
-
-typedef struct
-{
-  ISeqOutStream s;
-  CSzFile file;
-} CFileOutStream;
-
-void FileOutStream_CreateVTable(CFileOutStream *p);
-
-EXTERN_C_END
-
-#endif
+/* 7zFile.h -- File IO
+2009-11-24 : Igor Pavlov : Public domain */
+
+#ifndef __7Z_FILE_H
+#define __7Z_FILE_H
+
+#ifdef _WIN32
+#define USE_WINDOWS_FILE
+#endif
+
+#ifdef USE_WINDOWS_FILE
+#include <windows.h>
+#else
+#include <stdio.h>
+#endif
+
+#include "Types.h"
+
+EXTERN_C_BEGIN
+
+/* ---------- File ---------- */
+
+typedef struct
+{
+  #ifdef USE_WINDOWS_FILE
+  HANDLE handle;
+  #else
+  FILE *file;
+  #endif
+} CSzFile;
+
+void File_Construct(CSzFile *p);
+#if !defined(UNDER_CE) || !defined(USE_WINDOWS_FILE)
+WRes InFile_Open(CSzFile *p, const char *name);
+WRes OutFile_Open(CSzFile *p, const char *name);
+#endif
+#ifdef USE_WINDOWS_FILE
+WRes InFile_OpenW(CSzFile *p, const WCHAR *name);
+WRes OutFile_OpenW(CSzFile *p, const WCHAR *name);
+#endif
+WRes File_Close(CSzFile *p);
+
+/* reads max(*size, remain file's size) bytes */
+WRes File_Read(CSzFile *p, void *data, size_t *size);
+
+/* writes *size bytes */
+WRes File_Write(CSzFile *p, const void *data, size_t *size);
+
+WRes File_Seek(CSzFile *p, Int64 *pos, ESzSeek origin);
+WRes File_GetLength(CSzFile *p, UInt64 *length);
+
+
+/* ---------- FileInStream ---------- */
+
+typedef struct
+{
+  ISeqInStream s;
+  CSzFile file;
+} CFileSeqInStream;
+
+void FileSeqInStream_CreateVTable(CFileSeqInStream *p);
+
+
+typedef struct
+{
+  ISeekInStream s;
+  CSzFile file;
+} CFileInStream;
+
+void FileInStream_CreateVTable(CFileInStream *p);
+
+
+typedef struct
+{
+  ISeqOutStream s;
+  CSzFile file;
+} CFileOutStream;
+
+void FileOutStream_CreateVTable(CFileOutStream *p);
+
+
+/* ---------- FileMapInStream ---------- */
+
+/*
+FileMapInStream maps whole file to memory, and reads it with CMemInStream, so Look
+returns pointers to the mapped file without copying and without the limit of CLookToRead buffer.
+FileMapInStream_Open fails, if the file doesn't fit to address space;
+use CFileInStream with CLookToRead in that case.
+*/
+
+typedef struct
+{
+  CMemInStream mem;
+  #ifdef USE_WINDOWS_FILE
+  HANDLE map;
+  #endif
+} CFileMapInStream;
+
+void FileMapInStream_Construct(CFileMapInStream *p);
+#if !defined(UNDER_CE) || !defined(USE_WINDOWS_FILE)
+WRes FileMapInStream_Open(CFileMapInStream *p, const char *name);
+#endif
+WRes FileMapInStream_Close(CFileMapInStream *p);
+
+/* hint: the bytes [offset, offset + size) of the file will be read soon */
+void FileMapInStream_Prefetch(CFileMapInStream *p, UInt64 offset, UInt64 size);
+
+
+/* ---------- FileMapOut ---------- */
+
+/*
+FileMapOut_Open sets the size of file opened by OutFile_Open to (size), reserves
+the disk space for it, and maps the file to memory, so the data can be decoded
+directly to the pages of file without copying through the file stream.
+FileMapOut_Close unmaps the file, the file itself stays open.
+It fails for empty files, and if the file doesn't fit to address space.
+*/
+
+typedef struct
+{
+  Byte *data;
+  size_t size;
+  #ifdef USE_WINDOWS_FILE
+  HANDLE map;
+  #endif
+} CFileMapOut;
+
+void FileMapOut_Construct(CFileMapOut *p);
+WRes FileMapOut_Open(CFileMapOut *p, CSzFile *file, UInt64 size);
+WRes FileMapOut_Close(CFileMapOut *p);
+
+EXTERN_C_END
+
+#endif
@@ -0,0 +1,594 @@
+/* 7zIndex.c -- Index of 7z archive: the parsed header in flat form
+Public domain */
+
+#include <string.h>
+
+#include "7z.h"
+#include "7zCrc.h"
+#include "CpuArch.h"
+
+/*
+The index is the tables of CSzArEx written one after another, so SzArEx_OpenIndex
+uses them in place from the memory (mapped file of index) without parsing:
+
+  CSzIndexHeader
+  key              - the data of caller, that identifies the archive
+  table directory  - offset and size of each table (UInt64 values)
+  tables           - each table is aligned for 8 bytes
+
+The tables are written in the formats of the structures of this build, so the
+index can be used only by the same build, it's checked by the sizes of types.
+The pointers in CSzFolder and CSzCoderInfo of the index are not used: these
+structures are copied, and they are linked to other tables by SzArEx_OpenIndex.
+*/
+
+#define k7zIndexVersion 1
+#define k7zIndexEndian 0x01020304
+
+static const Byte k7zIndexSignature[8] = { '7', 'z', 'I', 'n', 'd', 'e', 'x', k7zIndexVersion };
+
+typedef struct
+{
+  Byte Signature[8];
+  Byte Layout[8];     /* sizes of types */
+  UInt32 Endian;
+  UInt32 Crc;         /* CRC of the header (with Crc == 0), the key and the table directory */
+  UInt64 KeySize;
+  UInt64 StartPosAfterHeader;
+  UInt64 DataPos;
+  UInt32 NumPackStreams;
+  UInt32 NumFolders;
+  UInt32 NumFiles;
+  UInt32 NameHashMask;
+} CSzIndexHeader;
+
+enum
+{
+  kIndexPackSizes,
+  kIndexPackCRCsDefined,
+  kIndexPackCRCs,
+  kIndexFolders,
+  kIndexCoders,
+  kIndexCoderProps,
+  kIndexBindPairs,
+  kIndexFolderPackStreams,
+  kIndexUnpackSizes,
+  kIndexFiles,
+  kIndexFolderStartPackStreamIndex,
+  kIndexPackStreamStartPositions,
+  kIndexFolderStartFileIndex,
+  kIndexFileIndexToFolderIndexMap,
+  kIndexFileUnpackPos,
+  kIndexFileNameOffsets,
+  kIndexFileNames,
+  kIndexNameHash,
+  kIndexBaseNameHash,
+  kIndexNameNext,
+  kIndexBaseNameNext,
+  kIndexNameHashes,
+  kIndexBaseNameHashes,
+  kIndexUtf8NameOffsets,
+  kIndexUtf8Names,
+  kIndexNumTables
+};
+
+/* the limits of SzGetNextFolderItem in 7zIn.c */
+#define NUM_FOLDER_CODERS_MAX 32
+#define NUM_CODER_STREAMS_MAX 32
+
+#define INDEX_ALIGN(size) (((size) + 7) & ~(UInt64)7)
+
+static void SzIndex_GetLayout(Byte *layout)
+{
+  layout[0] = (Byte)sizeof(size_t);
+  layout[1] = (Byte)sizeof(void *);
+  layout[2] = (Byte)sizeof(CSzFileItem);
+  layout[3] = (Byte)sizeof(CSzFolder);
+  layout[4] = (Byte)sizeof(CSzCoderInfo);
+  layout[5] = (Byte)sizeof(CSzBindPair);
+  layout[6] = 0;
+  layout[7] = 0;
+}
+
+/* the size of table, that is defined by the numbers of items in CSzArEx,
+  or 0 for the tables of folders and the tables of names */
+static UInt64 SzIndex_GetTableSize(const CSzArEx *p, unsigned table)
+{
+  UInt64 numPackStreams = p->db.NumPackStreams;
+  UInt64 numFolders = p->db.NumFolders;
+  UInt64 numFiles = p->db.NumFiles;
+  switch (table)
+  {
+    case kIndexPackSizes:
+    case kIndexPackStreamStartPositions: return numPackStreams * sizeof(UInt64);
+    case kIndexPackCRCsDefined: return numPackStreams;
+    case kIndexPackCRCs: return numPackStreams * sizeof(UInt32);
+    case kIndexFolders: return numFolders * sizeof(CSzFolder);
+    case kIndexFolderStartPackStreamIndex:
+    case kIndexFolderStartFileIndex: return numFolders * sizeof(UInt32);
+    case kIndexFiles: return numFiles * sizeof(CSzFileItem);
+    case kIndexFileIndexToFolderIndexMap:
+    case kIndexNameNext:
+    case kIndexBaseNameNext:
+    case kIndexNameHashes:
+    case kIndexBaseNameHashes: return numFiles * sizeof(UInt32);
+    case kIndexFileUnpackPos: return numFiles * sizeof(UInt64);
+    case kIndexFileNameOffsets:
+    case kIndexUtf8NameOffsets: return (numFiles + 1) * sizeof(size_t);
+    case kIndexNameHash:
+    case kIndexBaseNameHash: return ((UInt64)p->NameHashMask + 1) * sizeof(UInt32);
+  }
+  return 0;
+}
+
+static const void *SzIndex_GetTable(const CSzArEx *p, unsigned table)
+{
+  switch (table)
+  {
+    case kIndexPackSizes: return p->db.PackSizes;
+    case kIndexPackCRCsDefined: return p->db.PackCRCsDefined;
+    case kIndexPackCRCs: return p->db.PackCRCs;
+    case kIndexFolders: return p->db.Folders;
+    case kIndexFiles: return p->db.Files;
+    case kIndexFolderStartPackStreamIndex: return p->FolderStartPackStreamIndex;
+    case kIndexPackStreamStartPositions: return p->PackStreamStartPositions;
+    case kIndexFolderStartFileIndex: return p->FolderStartFileIndex;
+    case kIndexFileIndexToFolderIndexMap: return p->FileIndexToFolderIndexMap;
+    case kIndexFileUnpackPos: return p->FileUnpackPos;
+    case kIndexFileNameOffsets: return p->FileNameOffsets;
+    case kIndexFileNames: return p->FileNames.data;
+    case kIndexNameHash: return p->NameHash;
+    case kIndexBaseNameHash: return p->BaseNameHash;
+    case kIndexNameNext: return p->NameNext;
+    case kIndexBaseNameNext: return p->BaseNameNext;
+    case kIndexNameHashes: return p->NameHashes;
+    case kIndexBaseNameHashes: return p->BaseNameHashes;
+    case kIndexUtf8NameOffsets: return p->Utf8NameOffsets;
+    case kIndexUtf8Names: return p->Utf8Names.data;
+  }
+  return 0;
+}
+
+static Bool SzIndex_IsFolderTable(unsigned table)
+{
+  return (Bool)(table >= kIndexCoders && table <= kIndexUnpackSizes);
+}
+
+static SRes SzIndex_Write(ISeqOutStream *outStream, const void *data, size_t size)
+{
+  if (size != 0 && outStream->Write(outStream, data, size) != size)
+    return SZ_ERROR_WRITE;
+  return SZ_OK;
+}
+
+static SRes SzIndex_WriteFolderTable(const CSzAr *db, unsigned table, ISeqOutStream *outStream)
+{
+  UInt32 i, j;
+  for (i = 0; i < db->NumFolders; i++)
+  {
+    const CSzFolder *f = db->Folders + i;
+    switch (table)
+    {
+      case kIndexCoders:
+        RINOK(SzIndex_Write(outStream, f->Coders, f->NumCoders * sizeof(CSzCoderInfo)));
+        break;
+      case kIndexCoderProps:
+        for (j = 0; j < f->NumCoders; j++)
+        {
+          RINOK(SzIndex_Write(outStream, f->Coders[j].Props.data, f->Coders[j].Props.size));
+        }
+        break;
+      case kIndexBindPairs:
+        RINOK(SzIndex_Write(outStream, f->BindPairs, f->NumBindPairs * sizeof(CSzBindPair)));
+        break;
+      case kIndexFolderPackStreams:
+        RINOK(SzIndex_Write(outStream, f->PackStreams, f->NumPackStreams * sizeof(UInt32)));
+        break;
+      default:
+        RINOK(SzIndex_Write(outStream, f->UnpackSizes,
+            SzFolder_GetNumOutStreams((CSzFolder *)f) * sizeof(UInt64)));
+    }
+  }
+  return SZ_OK;
+}
+
+SRes SzArEx_WriteIndex(const CSzArEx *p, const void *key, size_t keySize, ISeqOutStream *outStream)
+{
+  static const Byte zeros[8] = { 0 };
+  CSzIndexHeader h;
+  UInt64 dir[kIndexNumTables * 2];
+  UInt64 pos;
+  UInt32 crc;
+  unsigned t;
+
+  if (p->NotLoaded != 0)
+    return SZ_ERROR_PARAM;
+
+  for (t = 0; t < kIndexNumTables; t++)
+    dir[t * 2 + 1] = 0;
+  {
+    UInt32 i, j;
+    for (i = 0; i < p->db.NumFolders; i++)
+    {
+      CSzFolder *f = p->db.Folders + i;
+      dir[kIndexCoders * 2 + 1] += f->NumCoders * sizeof(CSzCoderInfo);
+      for (j = 0; j < f->NumCoders; j++)
+        dir[kIndexCoderProps * 2 + 1] += f->Coders[j].Props.size;
+      dir[kIndexBindPairs * 2 + 1] += f->NumBindPairs * sizeof(CSzBindPair);
+      dir[kIndexFolderPackStreams * 2 + 1] += f->NumPackStreams * sizeof(UInt32);
+      dir[kIndexUnpackSizes * 2 + 1] += SzFolder_GetNumOutStreams(f) * sizeof(UInt64);
+    }
+  }
+  pos = sizeof(h) + INDEX_ALIGN(keySize) + sizeof(dir);
+  for (t = 0; t < kIndexNumTables; t++)
+  {
+    if (!SzIndex_IsFolderTable(t) && SzIndex_GetTable(p, t) != 0)
+    {
+      if (t == kIndexFileNames)
+        dir[t * 2 + 1] = p->FileNames.size;
+      else if (t == kIndexUtf8Names)
+        dir[t * 2 + 1] = p->Utf8Names.size;
+      else
+        dir[t * 2 + 1] = SzIndex_GetTableSize(p, t);
+    }
+    dir[t * 2] = pos;
+    pos += INDEX_ALIGN(dir[t * 2 + 1]);
+  }
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.Signature, k7zIndexSignature, sizeof(h.Signature));
+  SzIndex_GetLayout(h.Layout);
+  h.Endian = k7zIndexEndian;
+  h.KeySize = keySize;
+  h.StartPosAfterHeader = p->startPosAfterHeader;
+  h.DataPos = p->dataPos;
+  h.NumPackStreams = p->db.NumPackStreams;
+  h.NumFolders = p->db.NumFolders;
+  h.NumFiles = p->db.NumFiles;
+  h.NameHashMask = p->NameHashMask;
+  crc = CrcUpdate(CRC_INIT_VAL, &h, sizeof(h));
+  crc = CrcUpdate(crc, key, keySize);
+  crc = CrcUpdate(crc, dir, sizeof(dir));
+  h.Crc = CRC_GET_DIGEST(crc);
+
+  RINOK(SzIndex_Write(outStream, &h, sizeof(h)));
+  RINOK(SzIndex_Write(outStream, key, keySize));
+  RINOK(SzIndex_Write(outStream, zeros, (size_t)(INDEX_ALIGN(keySize) - keySize)));
+  RINOK(SzIndex_Write(outStream, dir, sizeof(dir)));
+  for (t = 0; t < kIndexNumTables; t++)
+  {
+    UInt64 size = dir[t * 2 + 1];
+    if (SzIndex_IsFolderTable(t))
+    {
+      RINOK(SzIndex_WriteFolderTable(&p->db, t, outStream));
+    }
+    else
+    {
+      RINOK(SzIndex_Write(outStream, SzIndex_GetTable(p, t), (size_t)size));
+    }
+    RINOK(SzIndex_Write(outStream, zeros, (size_t)(INDEX_ALIGN(size) - size)));
+  }
+  return SZ_OK;
+}
+
+/* copying of folders and coders to one block, and linking them to the tables of index */
+static SRes SzIndex_ReadFolders(CSzArEx *p, const Byte * const *tables, const UInt64 *sizes, ISzAlloc *alloc)
+{
+  UInt32 numFolders = p->db.NumFolders;
+  UInt64 numCoders = sizes[kIndexCoders] / sizeof(CSzCoderInfo);
+  UInt64 foldersSize = INDEX_ALIGN((UInt64)numFolders * sizeof(CSzFolder));
+  UInt64 pos[kIndexNumTables];
+  CSzCoderInfo *coders;
+  UInt32 i, j;
+
+  if (numFolders == 0)
+    return (sizes[kIndexCoders] == 0) ? SZ_OK : SZ_ERROR_ARCHIVE;
+  if (sizes[kIndexCoders] % sizeof(CSzCoderInfo) != 0 ||
+      (size_t)(foldersSize + sizes[kIndexCoders]) != foldersSize + sizes[kIndexCoders])
+    return SZ_ERROR_ARCHIVE;
+  p->db.Folders = (CSzFolder *)IAlloc_Alloc(alloc, (size_t)(foldersSize + sizes[kIndexCoders]));
+  if (p->db.Folders == 0)
+    return SZ_ERROR_MEM;
+  coders = (CSzCoderInfo *)((Byte *)p->db.Folders + (size_t)foldersSize);
+  memcpy(p->db.Folders, tables[kIndexFolders], numFolders * sizeof(CSzFolder));
+  memcpy(coders, tables[kIndexCoders], (size_t)sizes[kIndexCoders]);
+
+  for (i = kIndexCoders; i <= kIndexUnpackSizes; i++)
+    pos[i] = 0;
+  for (i = 0; i < numFolders; i++)
+  {
+    CSzFolder *f = p->db.Folders + i;
+    UInt32 numInStreams = 0, numOutStreams = 0;
+    UInt64 size;
+    if (f->NumCoders > NUM_FOLDER_CODERS_MAX || f->NumCoders > numCoders - pos[kIndexCoders])
+      return SZ_ERROR_ARCHIVE;
+    f->Coders = coders + (size_t)pos[kIndexCoders];
+    pos[kIndexCoders] += f->NumCoders;
+    for (j = 0; j < f->NumCoders; j++)
+    {
+      CSzCoderInfo *coder = f->Coders + j;
+      CBuf *props = &coder->Props;
+      if (coder->NumInStreams > NUM_CODER_STREAMS_MAX ||
+          coder->NumOutStreams > NUM_CODER_STREAMS_MAX ||
+          props->size > sizes[kIndexCoderProps] - pos[kIndexCoderProps])
+        return SZ_ERROR_ARCHIVE;
+      props->data = (props->size == 0) ? 0 :
+          (Byte *)tables[kIndexCoderProps] + (size_t)pos[kIndexCoderProps];
+      pos[kIndexCoderProps] += props->size;
+      numInStreams += coder->NumInStreams;
+      numOutStreams += coder->NumOutStreams;
+    }
+    /* the numbers of streams, that SzGetNextFolderItem sets */
+    if (numOutStreams == 0 ||
+        f->NumBindPairs != numOutStreams - 1 ||
+        numInStreams < f->NumBindPairs ||
+        f->NumPackStreams != numInStreams - f->NumBindPairs)
+      return SZ_ERROR_ARCHIVE;
+
+    size = (UInt64)f->NumBindPairs * sizeof(CSzBindPair);
+    if (size > sizes[kIndexBindPairs] - pos[kIndexBindPairs])
+      return SZ_ERROR_ARCHIVE;
+    f->BindPairs = (size == 0) ? 0 :
+        (CSzBindPair *)(tables[kIndexBindPairs] + (size_t)pos[kIndexBindPairs]);
+    pos[kIndexBindPairs] += size;
+
+    size = (UInt64)f->NumPackStreams * sizeof(UInt32);
+    if (size > sizes[kIndexFolderPackStreams] - pos[kIndexFolderPackStreams])
+      return SZ_ERROR_ARCHIVE;
+    f->PackStreams = (size == 0) ? 0 :
+        (UInt32 *)(tables[kIndexFolderPackStreams] + (size_t)pos[kIndexFolderPackStreams]);
+    pos[kIndexFolderPackStreams] += size;
+
+    for (j = 0; j < f->NumBindPairs; j++)
+      if (f->BindPairs[j].InIndex >= numInStreams || f->BindPairs[j].OutIndex >= numOutStreams)
+        return SZ_ERROR_ARCHIVE;
+    for (j = 0; j < f->NumPackStreams; j++)
+      if (f->PackStreams[j] >= numInStreams)
+        return SZ_ERROR_ARCHIVE;
+
+    size = (UInt64)numOutStreams * sizeof(UInt64);
+    if (size > sizes[kIndexUnpackSizes] - pos[kIndexUnpackSizes])
+      return SZ_ERROR_ARCHIVE;
+    f->UnpackSizes = (size == 0) ? 0 :
+        (UInt64 *)(tables[kIndexUnpackSizes] + (size_t)pos[kIndexUnpackSizes]);
+    pos[kIndexUnpackSizes] += size;
+  }
+  for (i = kIndexCoderProps; i <= kIndexUnpackSizes; i++)
+    if (pos[i] != sizes[i])
+      return SZ_ERROR_ARCHIVE;
+  return (pos[kIndexCoders] == numCoders) ? SZ_OK : SZ_ERROR_ARCHIVE;
+}
+
+/* the lists of files of the same name: the slots and the links are (file index + 1) or 0,
+  the links go to greater indexes and there is an empty slot, so SzArEx_FindFile always stops */
+static SRes SzIndex_CheckNameHash(const CSzArEx *p, const UInt32 *table, const UInt32 *next)
+{
+  UInt32 numFiles = p->db.NumFiles;
+  UInt32 numUsed = 0;
+  UInt32 i;
+  if (p->NameHashMask < numFiles)
+    return SZ_ERROR_ARCHIVE;
+  for (i = 0; i <= p->NameHashMask; i++)
+    if (table[i] != 0)
+    {
+      if (table[i] > numFiles)
+        return SZ_ERROR_ARCHIVE;
+      numUsed++;
+    }
+  if (numUsed > numFiles)
+    return SZ_ERROR_ARCHIVE;
+  for (i = 0; i < numFiles; i++)
+    if (next[i] != 0 && (next[i] <= i + 1 || next[i] > numFiles))
+      return SZ_ERROR_ARCHIVE;
+  return SZ_OK;
+}
+
+/* the tables of index are used without checks of indexes, so they are compared
+  with the values, that SzArEx_Fill sets for the files and folders of index */
+static SRes SzIndex_CheckTables(const CSzArEx *p)
+{
+  UInt32 numFiles = p->db.NumFiles;
+  UInt32 folderIndex = 0;
+  UInt32 indexInFolder = 0;
+  UInt32 startPos = 0;
+  UInt64 startPosSize = 0;
+  UInt64 unpackPos = 0;
+  UInt32 i;
+
+  for (i = 0; i < p->db.NumFolders; i++)
+  {
+    if (p->FolderStartPackStreamIndex[i] != startPos ||
+        p->db.Folders[i].NumPackStreams > p->db.NumPackStreams - startPos)
+      return SZ_ERROR_ARCHIVE;
+    startPos += p->db.Folders[i].NumPackStreams;
+  }
+  for (i = 0; i < p->db.NumPackStreams; i++)
+  {
+    if (p->PackStreamStartPositions[i] != startPosSize)
+      return SZ_ERROR_ARCHIVE;
+    startPosSize += p->db.PackSizes[i];
+  }
+
+  for (i = 0; i < numFiles; i++)
+  {
+    const CSzFileItem *file = p->db.Files + i;
+    if (indexInFolder == 0)
+    {
+      if (!file->HasStream)
+      {
+        if (p->FileIndexToFolderIndexMap[i] != (UInt32)-1 || p->FileUnpackPos[i] != 0)
+          return SZ_ERROR_ARCHIVE;
+        continue;
+      }
+      unpackPos = 0;
+      for (;; folderIndex++)
+      {
+        if (folderIndex >= p->db.NumFolders || p->FolderStartFileIndex[folderIndex] != i)
+          return SZ_ERROR_ARCHIVE;
+        if (p->db.Folders[folderIndex].NumUnpackStreams != 0)
+          break;
+      }
+    }
+    if (p->FileIndexToFolderIndexMap[i] != folderIndex || p->FileUnpackPos[i] != unpackPos)
+      return SZ_ERROR_ARCHIVE;
+    if (!file->HasStream)
+      continue;
+    unpackPos += file->Size;
+    if (++indexInFolder >= p->db.Folders[folderIndex].NumUnpackStreams)
+    {
+      folderIndex++;
+      indexInFolder = 0;
+    }
+  }
+  if (indexInFolder != 0)
+    return SZ_ERROR_ARCHIVE;
+  for (; folderIndex < p->db.NumFolders; folderIndex++)
+    if (p->db.Folders[folderIndex].NumUnpackStreams != 0 ||
+        p->FolderStartFileIndex[folderIndex] != numFiles)
+      return SZ_ERROR_ARCHIVE;
+
+  /* each name is not empty string with null character at the end */
+  if (p->FileNameOffsets != 0)
+  {
+    if (p->FileNameOffsets[0] != 0)
+      return SZ_ERROR_ARCHIVE;
+    for (i = 0; i < numFiles; i++)
+    {
+      size_t end = p->FileNameOffsets[i + 1];
+      if (end <= p->FileNameOffsets[i] || end > p->FileNames.size / 2 ||
+          GetUi16(p->FileNames.data + (end - 1) * 2) != 0)
+        return SZ_ERROR_ARCHIVE;
+    }
+  }
+  if (p->Utf8NameOffsets != 0)
+  {
+    if (p->Utf8NameOffsets[0] != 0)
+      return SZ_ERROR_ARCHIVE;
+    for (i = 0; i < numFiles; i++)
+    {
+      size_t end = p->Utf8NameOffsets[i + 1];
+      if (end <= p->Utf8NameOffsets[i] || end > p->Utf8Names.size ||
+          p->Utf8Names.data[end - 1] != 0)
+        return SZ_ERROR_ARCHIVE;
+    }
+  }
+  if (p->NameHash != 0)
+  {
+    RINOK(SzIndex_CheckNameHash(p, p->NameHash, p->NameNext));
+    RINOK(SzIndex_CheckNameHash(p, p->BaseNameHash, p->BaseNameNext));
+  }
+  return SZ_OK;
+}
+
+/* the tables, that can be absent in the index */
+static Bool SzIndex_IsOptionalTable(unsigned table)
+{
+  return (Bool)(table == kIndexPackCRCsDefined || table == kIndexPackCRCs || table >= kIndexFileNameOffsets);
+}
+
+static SRes SzArEx_OpenIndex2(CSzArEx *p, const Byte *data, size_t size,
+    const void *key, size_t keySize, ISzAlloc *allocMain)
+{
+  CSzIndexHeader h;
+  Byte layout[8];
+  UInt64 dir[kIndexNumTables * 2];
+  UInt64 sizes[kIndexNumTables];
+  const Byte *tables[kIndexNumTables];
+  UInt64 headSize;
+  UInt32 crc, crcHeader;
+  unsigned t;
+
+  if (size < sizeof(h))
+    return SZ_ERROR_NO_ARCHIVE;
+  memcpy(&h, data, sizeof(h));
+  SzIndex_GetLayout(layout);
+  if (memcmp(h.Signature, k7zIndexSignature, sizeof(h.Signature)) != 0 ||
+      memcmp(h.Layout, layout, sizeof(layout)) != 0 ||
+      h.Endian != k7zIndexEndian)
+    return SZ_ERROR_NO_ARCHIVE;
+  if (h.KeySize != keySize ||
+      size - sizeof(h) < INDEX_ALIGN(h.KeySize) + sizeof(dir) ||
+      memcmp(data + sizeof(h), key, keySize) != 0)
+    return SZ_ERROR_NO_ARCHIVE;
+  headSize = sizeof(h) + INDEX_ALIGN(h.KeySize) + sizeof(dir);
+  memcpy(dir, data + (size_t)headSize - sizeof(dir), sizeof(dir));
+  crcHeader = h.Crc;
+  h.Crc = 0;
+  crc = CrcUpdate(CRC_INIT_VAL, &h, sizeof(h));
+  crc = CrcUpdate(crc, key, keySize);
+  crc = CrcUpdate(crc, dir, sizeof(dir));
+  if (CRC_GET_DIGEST(crc) != crcHeader)
+    return SZ_ERROR_CRC;
+
+  p->startPosAfterHeader = h.StartPosAfterHeader;
+  p->dataPos = h.DataPos;
+  p->db.NumPackStreams = h.NumPackStreams;
+  p->db.NumFolders = h.NumFolders;
+  p->db.NumFiles = h.NumFiles;
+  p->NameHashMask = h.NameHashMask;
+
+  for (t = 0; t < kIndexNumTables; t++)
+  {
+    UInt64 offset = dir[t * 2];
+    sizes[t] = dir[t * 2 + 1];
+    if (offset < headSize || (offset & 7) != 0 || offset > size || sizes[t] > size - offset)
+      return SZ_ERROR_ARCHIVE;
+    tables[t] = (sizes[t] == 0) ? 0 : data + (size_t)offset;
+    if (!SzIndex_IsFolderTable(t) && t != kIndexFileNames && t != kIndexUtf8Names &&
+        sizes[t] != SzIndex_GetTableSize(p, t) &&
+        (sizes[t] != 0 || !SzIndex_IsOptionalTable(t)))
+      return SZ_ERROR_ARCHIVE;
+  }
+  /* the names are the strings of offsets tables, the hash tables require the names */
+  if ((sizes[kIndexFileNameOffsets] == 0 && sizes[kIndexFileNames] != 0) ||
+      (sizes[kIndexFileNameOffsets] != 0 &&
+        ((const size_t *)tables[kIndexFileNameOffsets])[h.NumFiles] * 2 != sizes[kIndexFileNames]) ||
+      (sizes[kIndexUtf8NameOffsets] == 0 && sizes[kIndexUtf8Names] != 0) ||
+      (sizes[kIndexUtf8NameOffsets] != 0 &&
+        ((const size_t *)tables[kIndexUtf8NameOffsets])[h.NumFiles] != sizes[kIndexUtf8Names]))
+    return SZ_ERROR_ARCHIVE;
+  for (t = kIndexNameHash; t <= kIndexBaseNameHashes; t++)
+    if ((sizes[t] == 0) != (sizes[kIndexNameHash] == 0) ||
+        (sizes[t] != 0 && sizes[kIndexFileNameOffsets] == 0))
+      return SZ_ERROR_ARCHIVE;
+
+  RINOK(SzIndex_ReadFolders(p, tables, sizes, allocMain));
+
+  p->db.PackSizes = (UInt64 *)tables[kIndexPackSizes];
+  p->db.PackCRCsDefined = (Byte *)tables[kIndexPackCRCsDefined];
+  p->db.PackCRCs = (UInt32 *)tables[kIndexPackCRCs];
+  p->db.Files = (CSzFileItem *)tables[kIndexFiles];
+  p->FolderStartPackStreamIndex = (UInt32 *)tables[kIndexFolderStartPackStreamIndex];
+  p->PackStreamStartPositions = (UInt64 *)tables[kIndexPackStreamStartPositions];
+  p->FolderStartFileIndex = (UInt32 *)tables[kIndexFolderStartFileIndex];
+  p->FileIndexToFolderIndexMap = (UInt32 *)tables[kIndexFileIndexToFolderIndexMap];
+  p->FileUnpackPos = (UInt64 *)tables[kIndexFileUnpackPos];
+  p->FileNameOffsets = (size_t *)tables[kIndexFileNameOffsets];
+  p->FileNames.data = (Byte *)tables[kIndexFileNames];
+  p->FileNames.size = (size_t)sizes[kIndexFileNames];
+  p->NameHash = (UInt32 *)tables[kIndexNameHash];
+  p->BaseNameHash = (UInt32 *)tables[kIndexBaseNameHash];
+  p->NameNext = (UInt32 *)tables[kIndexNameNext];
+  p->BaseNameNext = (UInt32 *)tables[kIndexBaseNameNext];
+  p->NameHashes = (UInt32 *)tables[kIndexNameHashes];
+  p->BaseNameHashes = (UInt32 *)tables[kIndexBaseNameHashes];
+  if (p->NameHash == 0)
+    p->NameHashMask = 0;
+  p->Utf8NameOffsets = (size_t *)tables[kIndexUtf8NameOffsets];
+  p->Utf8Names.data = (Byte *)tables[kIndexUtf8Names];
+  p->Utf8Names.size = (size_t)sizes[kIndexUtf8Names];
+  p->NotLoaded = 0;
+  return SzIndex_CheckTables(p);
+}
+
+SRes SzArEx_OpenIndex(CSzArEx *p, const void *data, size_t size,
+    const void *key, size_t keySize, ISzAlloc *allocMain)
+{
+  SRes res;
+  SzArEx_Init(p);
+  p->Index = (const Byte *)data;
+  res = SzArEx_OpenIndex2(p, (const Byte *)data, size, key, keySize, allocMain);
+  if (res != SZ_OK)
+    SzArEx_Free(p, allocMain);
+  return res;
+}
@@ -1,569 +1,3019 @@
-#include <stdio.h>
-
-#include "7z.h"
-#include "7zCrc.h"
-#include "7zFile.h"
-#include "7zAlloc.h"
-
-#ifndef USE_WINDOWS_FILE
-/* for mkdir */
-#ifdef _WIN32
-#include <direct.h>
-#else
-#include <sys/stat.h>
-#include <errno.h>
-#endif
-#endif
-
-#ifdef _WIN32
-#define CHAR_PATH_SEPARATOR '\\'
-#else
-#define CHAR_PATH_SEPARATOR '/'
-#endif
-
-static ISzAlloc g_Alloc = { SzAlloc, SzFree };
-
-/* Âûäåëåíèå áëîêà äèíàìè÷åñêîé ïàìÿòè çàäàííîãî ðàçìåðà size */
-/*
- Â áèáëèîòåêå LZMA èñïîëüçóåòñÿ ñâîé äèñïåò÷åð äèíàìè÷åñêîé ïàìÿòè.
- Ðàçìåðû áëîêîâ ïàìÿòè, âûäåëÿåìûõ âïåðâûå, íåñêîëüêî áîëüøå, ÷åì çàòðåáîâàíî. 
- È åñëè ïðè íîâîì îáðàùåíèè çàïðàøèâàåìûé ðàçìåð ìåíüøå çàðàíåå âûäåëåííîãî,
- òî íîâîãî âûäåëåíèÿ ïàìÿòè ôèçè÷åñêè íå ïðîèñõîäèò.
-*/
-static int Buf_EnsureSize(CBuf *dest, size_t size)
-{
-  if (dest->size >= size)
-    return 1;
-  Buf_Free(dest, &g_Alloc);
-  return Buf_Create(dest, size, &g_Alloc);
-}
-
-/* Äàëåå èäåò êîä ïîääåðæêè widechar-ñòðîê äëÿ nonWindows ñèñòåì */
-#ifndef _WIN32
-
-static Byte kUtf8Limits[5] = { 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
-
-static Bool Utf16_To_Utf8(Byte *dest, size_t *destLen, const UInt16 *src, size_t srcLen)
-{
-  size_t destPos = 0, srcPos = 0;
-  for (;;)
-  {
-    unsigned numAdds;
-    UInt32 value;
-    if (srcPos == srcLen)
-    {
-      *destLen = destPos;
-      return True;
-    }
-    value = src[srcPos++];
-    if (value < 0x80)
-    {
-      if (dest)
-        dest[destPos] = (char)value;
-      destPos++;
-      continue;
-    }
-    if (value >= 0xD800 && value < 0xE000)
-    {
-      UInt32 c2;
-      if (value >= 0xDC00 || srcPos == srcLen)
-        break;
-      c2 = src[srcPos++];
-      if (c2 < 0xDC00 || c2 >= 0xE000)
-        break;
-      value = (((value - 0xD800) << 10) | (c2 - 0xDC00)) + 0x10000;
-    }
-    for (numAdds = 1; numAdds < 5; numAdds++)
-      if (value < (((UInt32)1) << (numAdds * 5 + 6)))
-        break;
-    if (dest)
-      dest[destPos] = (char)(kUtf8Limits[numAdds - 1] + (value >> (6 * numAdds)));
-    destPos++;
-    do
-    {
-      numAdds--;
-      if (dest)
-        dest[destPos] = (char)(0x80 + ((value >> (6 * numAdds)) & 0x3F));
-      destPos++;
-    }
-    while (numAdds != 0);
-  }
-  *destLen = destPos;
-  return False;
-}
-
-static SRes Utf16_To_Utf8Buf(CBuf *dest, const UInt16 *src, size_t srcLen)
-{
-  size_t destLen = 0;
-  Bool res;
-  Utf16_To_Utf8(NULL, &destLen, src, srcLen);
-  destLen += 1;
-  if (!Buf_EnsureSize(dest, destLen))
-    return SZ_ERROR_MEM;
-  res = Utf16_To_Utf8(dest->data, &destLen, src, srcLen);
-  dest->data[destLen] = 0;
-  return res ? SZ_OK : SZ_ERROR_FAIL;
-}
-#endif
-
-/* Ïðåîáðàçîâàíèå widechar-ñòðîê â îáû÷íûå ñòðîêè */
-static WRes Utf16_To_Char(CBuf *buf, const UInt16 *s, int fileMode)
-{
-  int len = 0;
-  for (len = 0; s[len] != '\0'; len++);
-
-  #ifdef _WIN32
-  {
-    int size = len * 3 + 100;
-    if (!Buf_EnsureSize(buf, size))
-      return SZ_ERROR_MEM;
-    {
-      char defaultChar = '_';
-      BOOL defUsed;
-      int numChars = WideCharToMultiByte(fileMode ? (AreFileApisANSI() ? CP_ACP : CP_OEMCP) : CP_OEMCP,
-          0, s, len, (char *)buf->data, size, &defaultChar, &defUsed);
-      if (numChars == 0 || numChars >= size)
-        return SZ_ERROR_FAIL;
-      buf->data[numChars] = 0;
-      return SZ_OK;
-    }
-  }
-  #else
-  fileMode = fileMode;
-  return Utf16_To_Utf8Buf(buf, s, len);
-  #endif
-}
-
-/* Ñîçäàíèå êàòàëîãà ñ widechar-èìåíåì name */
-static WRes MyCreateDir(const UInt16 *name)
-{
-  #ifdef USE_WINDOWS_FILE
-  
-  return CreateDirectoryW(name, NULL) ? 0 : GetLastError();
-  
-  #else
-
-  CBuf buf;
-  WRes res;
-  Buf_Init(&buf);
-  RINOK(Utf16_To_Char(&buf, name, 1));
-
-  res =
-  #ifdef _WIN32
-  _mkdir((const char *)buf.data)
-  #else
-  mkdir((const char *)buf.data, 0777)
-  #endif
-  == 0 ? 0 : errno;
-  Buf_Free(&buf, &g_Alloc);
-  return res;
-  
-  #endif
-}
-
-/* Îòêðûòü ôàéë ñ widechar-èìåíåì name */
-static WRes OutFile_OpenUtf16(CSzFile *p, const UInt16 *name)
-{
-  #ifdef USE_WINDOWS_FILE
-  return OutFile_OpenW(p, name);
-  #else
-  CBuf buf;
-  WRes res;
-  Buf_Init(&buf);
-  RINOK(Utf16_To_Char(&buf, name, 1));
-  res = OutFile_Open(p, (const char *)buf.data);
-  Buf_Free(&buf, &g_Alloc);
-  return res;
-  #endif
-}
-
-/* Âûâåñòè íà êîíñîëü widechar-ñòðîêó s */
-static void PrintString(const UInt16 *s)
-{
-  CBuf buf;
-  Buf_Init(&buf);
-  if (Utf16_To_Char(&buf, s, 0) == 0)
-  {
-    printf("%s", buf.data);
-    Buf_Free(&buf, &g_Alloc);
-  }
-}
-
-/* Ñðàâíèòü widechar-ñòðîêó utf ñ îáû÷íîé ñòðîêîé s */
-static int CompareUtf16_String(const UInt16 *utf, const char* s)
-{
-  CBuf buf;
-  int res = 1;
-  Buf_Init(&buf);
-  if (Utf16_To_Char(&buf, utf, 0) == 0)
-  {
-    res = strcmp(buf.data, s);
-    Buf_Free(&buf, &g_Alloc);
-  }
-  return res;
-}
-
-/* Ïîêàçàòü ñîäåðæèìîå àðõèâà archiveFile */
-SRes List7zFiles(char* archiveFile) {
-  CFileInStream archiveStream;
-  CLookToRead lookStream;
-  CSzArEx db;
-  SRes res;
-  ISzAlloc allocImp;
-  ISzAlloc allocTempImp;
-  UInt16 *temp = NULL;
-  size_t tempSize = 0;
-
-  allocImp.Alloc = SzAlloc;
-  allocImp.Free = SzFree;
-
-  allocTempImp.Alloc = SzAllocTemp;
-  allocTempImp.Free = SzFreeTemp;
-
-  /* îòêðûòü ôàéë àðõèâà */
-  if (InFile_Open(&archiveStream.file, archiveFile))
-  {
-    printf("\nERROR: can not open input file");
-    return SZ_ERROR_FAIL;
-  }
-
-  printf("Contents of archive %s:\n\n", archiveFile);
- 
-  /* èíèöèàëèçèðóåì ïîòîê ñæàòûõ äàííûõ -- â äàííîì ñëó÷àå ÷èòàåì èç ôàéëà */
-  FileInStream_CreateVTable(&archiveStream);
-  /* óêàçûâàåì íà ñïîñîá äîñòóïà ê äàííûì */
-  LookToRead_CreateVTable(&lookStream, False);
-  
-  lookStream.realStream = &archiveStream.s;
-  /* óñòàíàâëèâàåì ïîçèöèþ ÷òåíèÿ íà íóëü */
-  LookToRead_Init(&lookStream);
-
-  /* èíèöèàëèçèðóåì ñòðóêòóðó, ñâÿçàííóþ ñ àðõèâîì */
-  SzArEx_Init(&db);
-  /* îòêðûâàåì àðõèâ è çàïîëíÿåì ñòðóêòóðó db */
-  res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
-  if (res == SZ_OK)
-  {
-    UInt32 i;
-
-    /* öèêë ïî âñåì ôàéëàì â àðõèâå */
-    for (i = 0; i < db.db.NumFiles; i++)
-    {
-      const CSzFileItem *f = db.db.Files + i;
-      size_t len;
-      /* óçíàåì ðàçìåð áëîêà ïàìÿòè ïîä ñòðîêó ñ èìåíåì ôàéëà */
-      len = SzArEx_GetFileNameUtf16(&db, i, NULL);
-      /* åñëè íåäîñòàòî÷íî -- âûäåëÿåì áîëüøå ïàìÿòè */
-      if (len > tempSize)
-      {
-        SzFree(NULL, temp);
-        tempSize = len;
-        temp = (UInt16 *)SzAlloc(NULL, tempSize * sizeof(temp[0]));
-        if (temp == 0)
-        {
-          res = SZ_ERROR_MEM;
-          break;
-        }
-      }
-      /* ïîëó÷àåì èìÿ ôàéëà ïî èíäåêñó */
-      SzArEx_GetFileNameUtf16(&db, i, temp);
-      /* âûâîäèì èìÿ ôàéëà */
-      PrintString(temp);
-      printf("\n");
-    }
-  }
-  /* îñâîáîæäàåì çàäåéñòâîâàííóþ äëÿ ðàáîòû äèíàìè÷åñêóþ ïàìÿòü */
-  SzArEx_Free(&db, &allocImp);
-  SzFree(NULL, temp);
-  /* çàêðûâàåì ôàéë àðõèâà */
-  File_Close(&archiveStream.file);
-  return res;
-}
-
-
-/* Ðàñïàêîâàòü ôàéë fileName èç àðõèâà archiveFile */
-SRes Decode7zOneFile(char* archiveFile, char* fileName) {
-  CFileInStream archiveStream;
-  CLookToRead lookStream;
-  CSzArEx db;
-  SRes res;
-  ISzAlloc allocImp;
-  ISzAlloc allocTempImp;
-  UInt16 *name = NULL;
-  size_t nameSize = 0;
-
-  allocImp.Alloc = SzAlloc;
-  allocImp.Free = SzFree;
-
-  allocTempImp.Alloc = SzAllocTemp;
-  allocTempImp.Free = SzFreeTemp;
-
-  /* îòêðûòü ôàéë àðõèâà */
-  if (InFile_Open(&archiveStream.file, archiveFile))
-  {
-    printf("\nERROR: can not open input file");
-    return SZ_ERROR_FAIL;
-  }
-
-  /* èíèöèàëèçèðóåì ïîòîê ñæàòûõ äàííûõ -- â äàííîì ñëó÷àå ÷èòàåì èç ôàéëà */
-  FileInStream_CreateVTable(&archiveStream);
-  /* óêàçûâàåì íà ñïîñîá äîñòóïà ê äàííûì */
-  LookToRead_CreateVTable(&lookStream, False);
-  
-  lookStream.realStream = &archiveStream.s;
-  /* óñòàíàâëèâàåì ïîçèöèþ ÷òåíèÿ íà íóëü */
-  LookToRead_Init(&lookStream);
-
-  /* èíèöèàëèçèðóåì ñòðóêòóðó, ñâÿçàííóþ ñ àðõèâîì */
-  SzArEx_Init(&db);
-  /* îòêðûâàåì àðõèâ è çàïîëíÿåì ñòðóêòóðó db */
-  res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
-  if (res == SZ_OK)
-  {
-    UInt32 i;
-    /*
-    if you need cache, use these 3 variables.
-    if you use external function, you can make these variable as static.
-    */
-    UInt32 blockIndex = 0xFFFFFFFF; /* it can have any value before first call (if outBuffer = 0) */
-    Byte *outBuffer = 0; /* it must be 0 before first call for each new archive. */
-    size_t outBufferSize = 0;  /* it can have any value before first call (if outBuffer = 0) */
-
-    /* öèêë ïî âñåì ôàéëàì â àðõèâå */
-    for (i = 0; i < db.db.NumFiles; i++)
-    {
-      size_t offset = 0;
-      size_t outSizeProcessed = 0;
-      const CSzFileItem *f = db.db.Files + i;
-      CSzFile outFile;
-      size_t len, j, processedSize;
-      const UInt16 *destPath = (const UInt16 *)name;
-
-      /* åñëè ýòî êàòàëîã -- ïðîïóñêàåì */
-      if (f->IsDir)
-        continue;
-      /* óçíàåì ðàçìåð áëîêà ïàìÿòè ïîä ñòðîêó ñ èìåíåì ôàéëà */
-      len = SzArEx_GetFileNameUtf16(&db, i, NULL);
-      /* åñëè íåäîñòàòî÷íî -- âûäåëÿåì áîëüøå ïàìÿòè */
-      if (len > nameSize)
-      {
-        SzFree(NULL, name);
-        nameSize = len;
-        name = (UInt16 *)SzAlloc(NULL, nameSize * sizeof(name[0]));
-        if (name == 0)
-        {
-          res = SZ_ERROR_MEM;
-          break;
-        }
-      }
-      /* ïîëó÷àåì èìÿ ôàéëà ïî èíäåêñó */
-      SzArEx_GetFileNameUtf16(&db, i, name);
-      /* ôîðìèðóåì èìÿ ôàéëà áåç ïîäêàòàëîãîâ */
-      for (j = 0; name[j] != 0; j++)
-        if (name[j] == '/')
-          destPath = name + j + 1;
-      /* ñðàâíèâàåì èìÿ òåêóùåãî ôàéëà ñ çàäàííûì */
-      if (CompareUtf16_String(destPath, fileName) != 0)
-        continue;
-      /* ðàñïàêîâûâàåì ôàéë âî âðåìåííûé áóôåð */
-      res = SzArEx_Extract(&db, &lookStream.s, i,
-          &blockIndex, &outBuffer, &outBufferSize,
-          &offset, &outSizeProcessed,
-          &allocImp, &allocTempImp);
-      if (res != SZ_OK)
-        //printf("nameSize = %d\n", nameSize);
-        //printf("i=%d\n", i);
-        printf("i: %d, outBufferSize: %ld, offset: %ld, outSizeProcessed: %ld\n", i, outBufferSize, offset, outSizeProcessed);
-        break;
-      /* îòêðûâàåì ôàéë äëÿ çàïèñè */
-      if (OutFile_OpenUtf16(&outFile, destPath))
-      {
-        printf("\nERROR: can not open output file");
-        res = SZ_ERROR_FAIL;
-        break;
-      }
-      processedSize = outSizeProcessed;
-      /* çàïèñûâàåì ðàñïàêîâàííûé áóôåð â ôàéë */
-      if (File_Write(&outFile, outBuffer + offset, &processedSize) != 0 || processedSize != outSizeProcessed)
-      {
-        printf("\nERROR: can not write output file");
-        res = SZ_ERROR_FAIL;
-        break;
-      }
-      /* çàêðûâàåì ôàéë */
-      if (File_Close(&outFile))
-      {
-        printf("\nERROR: can not close output file");
-        res = SZ_ERROR_FAIL;
-        break;
-      }
-      /* åñëè ïîä Windows, òî óñòàíàâëèâàåì àòðèáóòû ôàéëà */
-      #ifdef USE_WINDOWS_FILE
-      if (f->AttribDefined)
-        SetFileAttributesW(destPath, f->Attrib);
-      #endif
-
-    }
-    /* îñâîáîæäàåì çàäåéñòâîâàííóþ äëÿ ðàáîòû äèíàìè÷åñêóþ ïàìÿòü */
-    IAlloc_Free(&allocImp, outBuffer);
-  }
-  SzArEx_Free(&db, &allocImp);
-  SzFree(NULL, name);
-  /* çàêðûâàåì ôàéë àðõèâà */
-  File_Close(&archiveStream.file);
-  
-  return res;
-}
-
-
-/* Ðàñïàêîâàòü àðõèâ archiveFile
- ïðè fullPaths==1  ñ ñîõðàíåíèåì ñòðóêòóðû ïîäêàòàëîãîâ  */ 
-SRes Decode7zFiles(char* archiveFile, int fullPaths) {
-  CFileInStream archiveStream;
-  CLookToRead lookStream;
-  CSzArEx db;
-  SRes res;
-  ISzAlloc allocImp;
-  ISzAlloc allocTempImp;
-  UInt16 *temp = NULL;
-  size_t tempSize = 0;
-
-  allocImp.Alloc = SzAlloc;
-  allocImp.Free = SzFree;
-
-  allocTempImp.Alloc = SzAllocTemp;
-  allocTempImp.Free = SzFreeTemp;
-
-  /* îòêðûòü ôàéë àðõèâà */
-  if (InFile_Open(&archiveStream.file, archiveFile))
-  {
-    printf("\nERROR: can not open input file");
-    return SZ_ERROR_FAIL;
-  }
-
-  /* èíèöèàëèçèðóåì ïîòîê ñæàòûõ äàííûõ -- â äàííîì ñëó÷àå ÷èòàåì èç ôàéëà */
-  FileInStream_CreateVTable(&archiveStream);
-  /* óêàçûâàåì íà ñïîñîá äîñòóïà ê äàííûì */
-  LookToRead_CreateVTable(&lookStream, False);
-  
-  lookStream.realStream = &archiveStream.s;
-  /* óñòàíàâëèâàåì ïîçèöèþ ÷òåíèÿ íà íóëü */
-  LookToRead_Init(&lookStream);
-
-  /* èíèöèàëèçèðóåì ñòðóêòóðó, ñâÿçàííóþ ñ àðõèâîì */
-  SzArEx_Init(&db);
-  /* îòêðûâàåì àðõèâ è çàïîëíÿåì ñòðóêòóðó db */
-  res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
-  if (res == SZ_OK)
-  {
-    UInt32 i;
-    /*
-    if you need cache, use these 3 variables.
-    if you use external function, you can make these variable as static.
-    */
-    UInt32 blockIndex = 0xFFFFFFFF; /* it can have any value before first call (if outBuffer = 0) */
-    Byte *outBuffer = 0; /* it must be 0 before first call for each new archive. */
-    size_t outBufferSize = 0;  /* it can have any value before first call (if outBuffer = 0) */
-
-    /* öèêë ïî âñåì ôàéëàì â àðõèâå */
-    for (i = 0; i < db.db.NumFiles; i++)
-    {
-      size_t offset = 0;
-      size_t outSizeProcessed = 0;
-      const CSzFileItem *f = db.db.Files + i;
-      size_t len;
-
-      /* åñëè ýòî êàòàëîã è íå íóæíî âîññîçäàâàòü ñòðóêòóðó ïîäêàòàëîãîâ
-         -- ïðîïóñêàåì */
-      if (f->IsDir && !fullPaths)
-        continue;
-      /* óçíàåì ðàçìåð áëîêà ïàìÿòè ïîä ñòðîêó ñ èìåíåì ôàéëà */
-      len = SzArEx_GetFileNameUtf16(&db, i, NULL);
-      /* åñëè íåäîñòàòî÷íî -- âûäåëÿåì áîëüøå ïàìÿòè */
-      if (len > tempSize)
-      {
-        SzFree(NULL, temp);
-        tempSize = len;
-        temp = (UInt16 *)SzAlloc(NULL, tempSize * sizeof(temp[0]));
-        if (temp == 0)
-        {
-          res = SZ_ERROR_MEM;
-          break;
-        }
-      }
-      /* ïîëó÷àåì èìÿ ôàéëà ïî èíäåêñó */
-      SzArEx_GetFileNameUtf16(&db, i, temp);
-      /* åñëè ýòî íå êàòàëîã, òî ðàñïàêîâûâàåì ôàéë â áóôåð */
-      if (!(f->IsDir))
-      {
-        res = SzArEx_Extract(&db, &lookStream.s, i,
-            &blockIndex, &outBuffer, &outBufferSize,
-            &offset, &outSizeProcessed,
-            &allocImp, &allocTempImp);
-        if (res != SZ_OK)
-          break;
-      }
-
-      {
-        CSzFile outFile;
-        size_t processedSize, j;
-        UInt16 *name = (UInt16 *)temp;
-        const UInt16 *destPath = (const UInt16 *)name;
-        /* ôîðìèðóåì ïîëíîå èìÿ ôàéëà (ñ ó÷åòîì ïîäêàòàëîãîâ) */
-        for (j = 0; name[j] != 0; j++)
-          if (name[j] == '/')
-          {
-            if (fullPaths)
-            {
-              name[j] = 0;
-              MyCreateDir(name);
-              name[j] = CHAR_PATH_SEPARATOR;
-            }
-            else
-              destPath = name + j + 1;
-          }
-        /* åñëè ýòî êàòàëîã, òî ñîçäàåì åãî */
-        if (f->IsDir)
-        {
-          MyCreateDir(destPath);
-          continue;
-        }
-
-        else if (OutFile_OpenUtf16(&outFile, destPath))
-        {
-          printf("\nERROR: can not open output file");
-          res = SZ_ERROR_FAIL;
-          break;
-        }
-        processedSize = outSizeProcessed;
-        /* çàïèñûâàåì ðàñïàêîâàííûé áóôåð â ôàéë */
-        if (File_Write(&outFile, outBuffer + offset, &processedSize) != 0 || processedSize != outSizeProcessed)
-        {
-          printf("\nERROR: can not write output file");
-          res = SZ_ERROR_FAIL;
-          break;
-        }
-        /* çàêðûâàåì ôàéë */
-        if (File_Close(&outFile))
-        {
-          printf("\nERROR: can not close output file");
-          res = SZ_ERROR_FAIL;
-          break;
-        }
-        /* åñëè ïîä Windows, òî óñòàíàâëèâàåì àòðèáóòû ôàéëà */
-        #ifdef USE_WINDOWS_FILE
-        if (f->AttribDefined)
-          SetFileAttributesW(destPath, f->Attrib);
-        #endif
-      }
-
-    }
-    /* îñâîáîæäàåì çàäåéñòâîâàííóþ äëÿ ðàáîòû äèíàìè÷åñêóþ ïàìÿòü */
-    IAlloc_Free(&allocImp, outBuffer);
-  }
-  SzArEx_Free(&db, &allocImp);
-  SzFree(NULL, temp);
-  /* çàêðûâàåì ôàéë àðõèâà */
-  File_Close(&archiveStream.file);
-  return res;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "7z.h"
+#include "7zCrc.h"
+#include "7zFile.h"
+#include "7zAlloc.h"
+#include "Threads.h"
+#include "CpuArch.h"
+
+#if defined(MY_CPU_X86_OR_AMD64) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+    defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_UTF16_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifndef USE_WINDOWS_FILE
+/* for mkdir */
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <errno.h>
+#endif
+#endif
+
+/* for the index cache */
+#ifdef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define CHAR_PATH_SEPARATOR '\\'
+#else
+#define CHAR_PATH_SEPARATOR '/'
+#endif
+
+static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+
+/* Âûäåëåíèå áëîêà äèíàìè÷åñêîé ïàìÿòè çàäàííîãî ðàçìåðà size */
+/*
+ Â áèáëèîòåêå LZMA èñïîëüçóåòñÿ ñâîé äèñïåò÷åð äèíàìè÷åñêîé ïàìÿòè.
+ Ðàçìåðû áëîêîâ ïàìÿòè, âûäåëÿåìûõ âïåðâûå, íåñêîëüêî áîëüøå, ÷åì çàòðåáîâàíî. 
+ È åñëè ïðè íîâîì îáðàùåíèè çàïðàøèâàåìûé ðàçìåð ìåíüøå çàðàíåå âûäåëåííîãî,
+ òî íîâîãî âûäåëåíèÿ ïàìÿòè ôèçè÷åñêè íå ïðîèñõîäèò.
+*/
+static int Buf_EnsureSize(CBuf *dest, size_t size)
+{
+  if (dest->size >= size)
+    return 1;
+  Buf_Free(dest, &g_Alloc);
+  return Buf_Create(dest, size, &g_Alloc);
+}
+
+/* Äàëåå èäåò êîä ïîääåðæêè widechar-ñòðîê äëÿ nonWindows ñèñòåì */
+#ifndef _WIN32
+
+static Byte kUtf8Limits[5] = { 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
+
+/* copying the ASCII characters from the start of 'src' to 'dest',
+  returns the number of copied characters */
+static size_t Utf16_To_Utf8_Ascii(Byte *dest, const UInt16 *src, size_t srcLen)
+{
+  size_t i = 0;
+  #ifdef USE_UTF16_SSE2
+  const __m128i mask = _mm_set1_epi16((short)0xFF80);
+  const __m128i zero = _mm_setzero_si128();
+  for (; srcLen - i >= 8; i += 8)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), zero)) != 0xFFFF)
+      break;
+    _mm_storel_epi64((__m128i *)(dest + i), _mm_packus_epi16(v, v));
+  }
+  #endif
+  for (; i < srcLen && src[i] < 0x80; i++)
+    dest[i] = (Byte)src[i];
+  return i;
+}
+
+/* 'dest' must have (srcLen * 3) bytes: one UTF-16 character gives 3 bytes at most,
+  and the surrogate pair gives 4 bytes */
+static Bool Utf16_To_Utf8(Byte *dest, size_t *destLen, const UInt16 *src, size_t srcLen)
+{
+  size_t destPos = 0, srcPos = 0;
+  for (;;)
+  {
+    unsigned numAdds;
+    UInt32 value;
+    if (srcPos == srcLen)
+    {
+      *destLen = destPos;
+      return True;
+    }
+    value = src[srcPos];
+    if (value < 0x80)
+    {
+      size_t num = Utf16_To_Utf8_Ascii(dest + destPos, src + srcPos, srcLen - srcPos);
+      srcPos += num;
+      destPos += num;
+      continue;
+    }
+    srcPos++;
+    if (value >= 0xD800 && value < 0xE000)
+    {
+      UInt32 c2;
+      if (value >= 0xDC00 || srcPos == srcLen)
+        break;
+      c2 = src[srcPos++];
+      if (c2 < 0xDC00 || c2 >= 0xE000)
+        break;
+      value = (((value - 0xD800) << 10) | (c2 - 0xDC00)) + 0x10000;
+    }
+    for (numAdds = 1; numAdds < 5; numAdds++)
+      if (value < (((UInt32)1) << (numAdds * 5 + 6)))
+        break;
+    dest[destPos++] = (Byte)(kUtf8Limits[numAdds - 1] + (value >> (6 * numAdds)));
+    do
+    {
+      numAdds--;
+      dest[destPos++] = (Byte)(0x80 + ((value >> (6 * numAdds)) & 0x3F));
+    }
+    while (numAdds != 0);
+  }
+  *destLen = destPos;
+  return False;
+}
+
+/* the conversion in one pass: the buffer is allocated for the longest result */
+static SRes Utf16_To_Utf8Buf(CBuf *dest, const UInt16 *src, size_t srcLen)
+{
+  size_t destLen;
+  Bool res;
+  if (!Buf_EnsureSize(dest, srcLen * 3 + 1))
+    return SZ_ERROR_MEM;
+  res = Utf16_To_Utf8(dest->data, &destLen, src, srcLen);
+  dest->data[destLen] = 0;
+  return res ? SZ_OK : SZ_ERROR_FAIL;
+}
+
+static Bool Utf8_To_Utf16(UInt16 *dest, size_t *destLen, const char *src)
+{
+  const Byte *s = (const Byte *)src;
+  size_t destPos = 0;
+  for (;;)
+  {
+    unsigned numAdds;
+    UInt32 value = *s++;
+    if (value == 0)
+    {
+      *destLen = destPos;
+      return True;
+    }
+    if (value < 0x80)
+    {
+      if (dest)
+        dest[destPos] = (UInt16)value;
+      destPos++;
+      continue;
+    }
+    if (value < kUtf8Limits[0])
+      break;
+    for (numAdds = 1; numAdds < 5; numAdds++)
+      if (value < kUtf8Limits[numAdds])
+        break;
+    value -= kUtf8Limits[numAdds - 1];
+    do
+    {
+      Byte c = *s++;
+      if (c < 0x80 || c >= 0xC0)
+        return False;
+      value = (value << 6) | (c - 0x80);
+    }
+    while (--numAdds != 0);
+    if (value < 0x10000)
+    {
+      if (dest)
+        dest[destPos] = (UInt16)value;
+      destPos++;
+      continue;
+    }
+    value -= 0x10000;
+    if (value >= 0x100000)
+      break;
+    if (dest)
+    {
+      dest[destPos] = (UInt16)(0xD800 + (value >> 10));
+      dest[destPos + 1] = (UInt16)(0xDC00 + (value & 0x3FF));
+    }
+    destPos += 2;
+  }
+  *destLen = destPos;
+  return False;
+}
+#endif
+
+/* Ïðåîáðàçîâàíèå widechar-ñòðîê â îáû÷íûå ñòðîêè */
+static WRes Utf16_To_Char(CBuf *buf, const UInt16 *s, int fileMode)
+{
+  int len = 0;
+  for (len = 0; s[len] != '\0'; len++);
+
+  #ifdef _WIN32
+  {
+    int size = len * 3 + 100;
+    if (!Buf_EnsureSize(buf, size))
+      return SZ_ERROR_MEM;
+    {
+      char defaultChar = '_';
+      BOOL defUsed;
+      int numChars = WideCharToMultiByte(fileMode ? (AreFileApisANSI() ? CP_ACP : CP_OEMCP) : CP_OEMCP,
+          0, s, len, (char *)buf->data, size, &defaultChar, &defUsed);
+      if (numChars == 0 || numChars >= size)
+        return SZ_ERROR_FAIL;
+      buf->data[numChars] = 0;
+      return SZ_OK;
+    }
+  }
+  #else
+  fileMode = fileMode;
+  return Utf16_To_Utf8Buf(buf, s, len);
+  #endif
+}
+
+/* convertion of the regular string to the widechar string in 'buf',
+  '*len' is the number of widechar characters without null-terminating character */
+static WRes Char_To_Utf16(CBuf *buf, const char *s, size_t *len)
+{
+  #ifdef _WIN32
+  int size = (int)strlen(s) + 1;
+  int numChars;
+  if (!Buf_EnsureSize(buf, size * sizeof(UInt16)))
+    return SZ_ERROR_MEM;
+  numChars = MultiByteToWideChar(CP_OEMCP, 0, s, -1, (WCHAR *)buf->data, size);
+  if (numChars == 0)
+    return SZ_ERROR_FAIL;
+  *len = numChars - 1;
+  return SZ_OK;
+  #else
+  size_t destLen = 0;
+  if (!Utf8_To_Utf16(NULL, &destLen, s))
+    return SZ_ERROR_FAIL;
+  if (!Buf_EnsureSize(buf, (destLen + 1) * sizeof(UInt16)))
+    return SZ_ERROR_MEM;
+  Utf8_To_Utf16((UInt16 *)buf->data, len, s);
+  return SZ_OK;
+  #endif
+}
+
+/* Ñîçäàíèå êàòàëîãà ñ widechar-èìåíåì name */
+static WRes MyCreateDir(const UInt16 *name, CBuf *buf)
+{
+  #ifdef USE_WINDOWS_FILE
+  
+  buf = buf;
+  return CreateDirectoryW(name, NULL) ? 0 : GetLastError();
+  
+  #else
+
+  RINOK(Utf16_To_Char(buf, name, 1));
+
+  return
+  #ifdef _WIN32
+  _mkdir((const char *)buf->data)
+  #else
+  mkdir((const char *)buf->data, 0777)
+  #endif
+  == 0 ? 0 : errno;
+  
+  #endif
+}
+
+/* Îòêðûòü ôàéë ñ widechar-èìåíåì name */
+static WRes OutFile_OpenUtf16(CSzFile *p, const UInt16 *name, CBuf *buf)
+{
+  #ifdef USE_WINDOWS_FILE
+  buf = buf;
+  return OutFile_OpenW(p, name);
+  #else
+  RINOK(Utf16_To_Char(buf, name, 1));
+  return OutFile_Open(p, (const char *)buf->data);
+  #endif
+}
+
+/* Âûâåñòè íà êîíñîëü widechar-ñòðîêó s */
+static void PrintString(const UInt16 *s, CBuf *buf)
+{
+  if (Utf16_To_Char(buf, s, 0) == 0)
+    printf("%s", buf->data);
+}
+
+/* Read-ahead input stream: the archive file is read by separate thread to one
+  of two buffers, while the decoder uses the data of the other buffer.
+  The reads start at position aligned to the size of buffer, and each read
+  fills whole buffer, so the packed streams, that follow each other in archive,
+  are read before the decoder needs them. Look returns pointers to the buffer. */
+typedef struct
+{
+  ILookInStream s;
+  CSzFile file;
+  UInt64 fileSize;
+  UInt64 pos;         /* position of the decoder in the file */
+  size_t bufSize;
+  Byte *bufs[2];
+  UInt64 bufPos[2];   /* file position of the data in buffer */
+  size_t bufLen[2];
+  SRes bufRes[2];     /* the error of reading to buffer */
+  unsigned cur;       /* the buffer of decoder, the other one is filled by the thread */
+  Bool pending;       /* the thread fills the other buffer now */
+  Bool stop;
+  CThread thread;
+  CAutoResetEvent canFill; /* there is new request for the thread, or it must stop */
+  CAutoResetEvent filled;  /* the thread has filled the buffer */
+} CReadAheadInStream;
+
+static THREAD_FUNC_DECL ReadAheadInStream_ThreadFunc(void *pp)
+{
+  CReadAheadInStream *p = (CReadAheadInStream *)pp;
+  UInt64 filePos = 0;
+  for (;;)
+  {
+    unsigned index;
+    size_t len = 0;
+    SRes res = SZ_OK;
+    Event_Wait(&p->canFill);
+    if (p->stop)
+      break;
+    index = p->cur ^ 1;
+    if (filePos != p->bufPos[index])
+    {
+      Int64 pos = (Int64)p->bufPos[index];
+      if (File_Seek(&p->file, &pos, SZ_SEEK_SET) != 0)
+        res = SZ_ERROR_READ;
+      filePos = (UInt64)pos;
+    }
+    while (res == SZ_OK && len != p->bufSize)
+    {
+      size_t size = p->bufSize - len;
+      if (File_Read(&p->file, p->bufs[index] + len, &size) != 0)
+        res = SZ_ERROR_READ;
+      if (size == 0)
+        break;
+      len += size;
+      filePos += size;
+    }
+    p->bufLen[index] = len;
+    p->bufRes[index] = res;
+    if (res != SZ_OK)
+      filePos = (UInt64)(Int64)-1;
+    Event_Set(&p->filled);
+  }
+  return 0;
+}
+
+static void ReadAheadInStream_Fill(CReadAheadInStream *p, UInt64 bufPos)
+{
+  p->bufPos[p->cur ^ 1] = bufPos;
+  p->pending = True;
+  Event_Set(&p->canFill);
+}
+
+static void ReadAheadInStream_WaitFill(CReadAheadInStream *p)
+{
+  if (p->pending)
+  {
+    Event_Wait(&p->filled);
+    p->pending = False;
+  }
+}
+
+/* makes the buffer, that contains the current position, the buffer of decoder,
+  and starts reading of data after it to the other buffer */
+static SRes ReadAheadInStream_Switch(CReadAheadInStream *p)
+{
+  unsigned next = p->cur ^ 1;
+  UInt64 end;
+  ReadAheadInStream_WaitFill(p);
+  if (p->bufRes[next] != SZ_OK || p->pos < p->bufPos[next] || p->pos - p->bufPos[next] >= p->bufLen[next])
+  {
+    /* random access: the decoder waits for the data */
+    ReadAheadInStream_Fill(p, p->pos - p->pos % p->bufSize);
+    ReadAheadInStream_WaitFill(p);
+  }
+  p->cur = next;
+  RINOK(p->bufRes[next]);
+  end = p->bufPos[next] + p->bufLen[next];
+  if (p->bufLen[next] == p->bufSize && end < p->fileSize)
+    ReadAheadInStream_Fill(p, end);
+  return SZ_OK;
+}
+
+static SRes ReadAheadInStream_Look(void *pp, const void **buf, size_t *size)
+{
+  CReadAheadInStream *p = (CReadAheadInStream *)pp;
+  size_t rem;
+  if (p->pos >= p->fileSize)
+  {
+    *size = 0;
+    return SZ_OK;
+  }
+  if (p->pos < p->bufPos[p->cur] || p->pos - p->bufPos[p->cur] >= p->bufLen[p->cur])
+  {
+    SRes res = ReadAheadInStream_Switch(p);
+    if (res != SZ_OK)
+    {
+      *size = 0;
+      return res;
+    }
+    if (p->pos - p->bufPos[p->cur] >= p->bufLen[p->cur])
+    {
+      /* the file was truncated after opening */
+      *size = 0;
+      return SZ_OK;
+    }
+  }
+  rem = p->bufLen[p->cur] - (size_t)(p->pos - p->bufPos[p->cur]);
+  if (*size > rem)
+    *size = rem;
+  *buf = p->bufs[p->cur] + (size_t)(p->pos - p->bufPos[p->cur]);
+  return SZ_OK;
+}
+
+static SRes ReadAheadInStream_Skip(void *pp, size_t offset)
+{
+  CReadAheadInStream *p = (CReadAheadInStream *)pp;
+  p->pos += offset;
+  return SZ_OK;
+}
+
+static SRes ReadAheadInStream_Read(void *pp, void *buf, size_t *size)
+{
+  CReadAheadInStream *p = (CReadAheadInStream *)pp;
+  const void *lookBuf;
+  RINOK(ReadAheadInStream_Look(p, &lookBuf, size));
+  memcpy(buf, lookBuf, *size);
+  p->pos += *size;
+  return SZ_OK;
+}
+
+static SRes ReadAheadInStream_Seek(void *pp, Int64 *pos, ESzSeek origin)
+{
+  CReadAheadInStream *p = (CReadAheadInStream *)pp;
+  Int64 newPos = *pos;
+  switch (origin)
+  {
+    case SZ_SEEK_SET: break;
+    case SZ_SEEK_CUR: newPos += (Int64)p->pos; break;
+    case SZ_SEEK_END: newPos += (Int64)p->fileSize; break;
+    default: return SZ_ERROR_PARAM;
+  }
+  if (newPos < 0)
+    return SZ_ERROR_PARAM;
+  p->pos = (UInt64)newPos;
+  *pos = newPos;
+  return SZ_OK;
+}
+
+static WRes ReadAheadInStream_Open(CReadAheadInStream *p, const char *name, size_t bufSize)
+{
+  WRes res;
+  p->s.Look = ReadAheadInStream_Look;
+  p->s.Skip = ReadAheadInStream_Skip;
+  p->s.Read = ReadAheadInStream_Read;
+  p->s.Seek = ReadAheadInStream_Seek;
+  p->pos = 0;
+  p->bufSize = bufSize;
+  p->bufPos[0] = p->bufPos[1] = 0;
+  p->bufLen[0] = p->bufLen[1] = 0;
+  p->bufRes[0] = p->bufRes[1] = SZ_OK;
+  p->cur = 0;
+  p->pending = False;
+  p->stop = False;
+  Thread_Construct(&p->thread);
+  Event_Construct(&p->canFill);
+  Event_Construct(&p->filled);
+  RINOK(InFile_Open(&p->file, name));
+  res = File_GetLength(&p->file, &p->fileSize);
+  p->bufs[0] = p->bufs[1] = NULL;
+  if (res == 0)
+  {
+    p->bufs[0] = (Byte *)SzAlloc(NULL, bufSize);
+    p->bufs[1] = (Byte *)SzAlloc(NULL, bufSize);
+    if (p->bufs[0] == NULL || p->bufs[1] == NULL)
+      res = SZ_ERROR_MEM;
+  }
+  if (res == 0)
+    res = AutoResetEvent_CreateNotSignaled(&p->canFill);
+  if (res == 0)
+    res = AutoResetEvent_CreateNotSignaled(&p->filled);
+  if (res == 0)
+    res = Thread_Create(&p->thread, ReadAheadInStream_ThreadFunc, p);
+  if (res != 0)
+  {
+    Event_Close(&p->canFill);
+    Event_Close(&p->filled);
+    SzFree(NULL, p->bufs[0]);
+    SzFree(NULL, p->bufs[1]);
+    File_Close(&p->file);
+    return res;
+  }
+  return 0;
+}
+
+static void ReadAheadInStream_Close(CReadAheadInStream *p)
+{
+  ReadAheadInStream_WaitFill(p);
+  p->stop = True;
+  Event_Set(&p->canFill);
+  Thread_Wait(&p->thread);
+  Thread_Close(&p->thread);
+  Event_Close(&p->canFill);
+  Event_Close(&p->filled);
+  SzFree(NULL, p->bufs[0]);
+  SzFree(NULL, p->bufs[1]);
+  File_Close(&p->file);
+}
+
+/* the size of buffers of read-ahead stream, 0 - the archive is mapped to memory */
+static size_t g_ReadAheadSize = 0;
+
+/* the buffer of reading from the archive file, if it's not mapped to memory */
+#define IN_BUF_SIZE_DEFAULT (1 << 18)
+#define IN_BUF_MIN_READ_SIZE (1 << 14)
+
+/* 0 - the archive is mapped to memory, if it's possible */
+static size_t g_InBufSize = 0;
+static Bool g_InBufAdaptive = False;
+
+/* The archive: the file 'name', or the memory block 'data' of 'size' bytes, if 'name == NULL' */
+typedef struct
+{
+  const char *name;
+  const void *data;
+  size_t size;
+} CArchiveSource;
+
+/* Archive input stream: memory mapped archive file, or buffered reading from
+  the file, if it can not be mapped (for example, it's too big for 32-bit process)
+  or if the size of buffer is set by Set7zInBufSize, or read-ahead stream,
+  if it's enabled by Set7zReadAhead. The archive in memory is read without copying */
+typedef struct
+{
+  CMemInStream memStream;
+  CFileMapInStream mapStream;
+  CReadAheadInStream readAheadStream;
+  CFileInStream fileStream;
+  CLookToRead2 lookStream;
+  ILookInStream *s;
+} CArchiveInStream;
+
+static WRes ArchiveInStream_Open(CArchiveInStream *p, const CArchiveSource *src)
+{
+  const char *name = src->name;
+  if (name == NULL)
+  {
+    MemInStream_Init(&p->memStream, src->data, src->size);
+    p->s = &p->memStream.s;
+    return 0;
+  }
+  if (g_ReadAheadSize != 0)
+  {
+    RINOK(ReadAheadInStream_Open(&p->readAheadStream, name, g_ReadAheadSize));
+    p->s = &p->readAheadStream.s;
+    return 0;
+  }
+  if (g_InBufSize == 0 && FileMapInStream_Open(&p->mapStream, name) == 0)
+  {
+    p->s = &p->mapStream.mem.s;
+    return 0;
+  }
+  RINOK(InFile_Open(&p->fileStream.file, name));
+  /* initializing compressed stream - reading from the file in that case */
+  FileInStream_CreateVTable(&p->fileStream);
+  /* specifying data access method */
+  LookToRead2_CreateVTable(&p->lookStream, False);
+  p->lookStream.realStream = &p->fileStream.s;
+  p->lookStream.bufSize = (g_InBufSize != 0) ? g_InBufSize : IN_BUF_SIZE_DEFAULT;
+  p->lookStream.minReadSize = g_InBufAdaptive ? IN_BUF_MIN_READ_SIZE : 0;
+  p->lookStream.buf = (Byte *)SzAlloc(NULL, p->lookStream.bufSize);
+  if (p->lookStream.buf == NULL)
+  {
+    File_Close(&p->fileStream.file);
+    return SZ_ERROR_MEM;
+  }
+  /* reseting reading pointer's position */
+  LookToRead2_Init(&p->lookStream);
+  p->s = &p->lookStream.s;
+  return 0;
+}
+
+static void ArchiveInStream_Close(CArchiveInStream *p)
+{
+  if (p->s == &p->memStream.s)
+    return;
+  if (p->s == &p->mapStream.mem.s)
+    FileMapInStream_Close(&p->mapStream);
+  else if (p->s == &p->readAheadStream.s)
+    ReadAheadInStream_Close(&p->readAheadStream);
+  else
+  {
+    File_Close(&p->fileStream.file);
+    SzFree(NULL, p->lookStream.buf);
+  }
+}
+
+/* asking OS to read packed streams of solid block 'folderIndex' ahead of decoder */
+static void ArchiveInStream_PrefetchFolder(CArchiveInStream *p, const CSzArEx *db, UInt32 folderIndex)
+{
+  UInt64 packSize;
+  if (p->s != &p->mapStream.mem.s || SzArEx_GetFolderFullPackSize(db, folderIndex, &packSize) != SZ_OK)
+    return;
+  FileMapInStream_Prefetch(&p->mapStream, SzArEx_GetFolderStreamPos(db, folderIndex, 0), packSize);
+}
+
+/* Allocator that keeps freed blocks for the next allocations of the same size:
+  it's used for decoders and solid block buffers, so the tables and dictionaries
+  of LZMA decoder are allocated one time, and not for each solid block */
+#define ALLOC_CACHE_MAX_BLOCKS 4
+#define ALLOC_CACHE_HEADER_SIZE 16
+
+typedef struct
+{
+  ISzAlloc s;
+  Byte *blocks[ALLOC_CACHE_MAX_BLOCKS];
+  unsigned numBlocks;
+} CAllocCache;
+
+#define AllocCache_GetBlockSize(block) (*(size_t *)(void *)(block))
+
+static void *AllocCache_Alloc(void *pp, size_t size)
+{
+  CAllocCache *p = (CAllocCache *)pp;
+  Byte *block;
+  unsigned i;
+  if (size == 0)
+    return 0;
+  /* the cached block can be used, if it's not too big for the request */
+  for (i = 0; i < p->numBlocks; i++)
+  {
+    size_t blockSize = AllocCache_GetBlockSize(p->blocks[i]);
+    if (blockSize >= size && blockSize / 2 <= size)
+    {
+      block = p->blocks[i];
+      for (p->numBlocks--; i < p->numBlocks; i++)
+        p->blocks[i] = p->blocks[i + 1];
+      return block + ALLOC_CACHE_HEADER_SIZE;
+    }
+  }
+  if (size > (size_t)0 - 1 - ALLOC_CACHE_HEADER_SIZE)
+    return 0;
+  block = (Byte *)SzAllocTemp(NULL, size + ALLOC_CACHE_HEADER_SIZE);
+  if (block == 0)
+    return 0;
+  AllocCache_GetBlockSize(block) = size;
+  return block + ALLOC_CACHE_HEADER_SIZE;
+}
+
+static void AllocCache_Free(void *pp, void *address)
+{
+  CAllocCache *p = (CAllocCache *)pp;
+  Byte *block;
+  if (address == 0)
+    return;
+  block = (Byte *)address - ALLOC_CACHE_HEADER_SIZE;
+  /* the oldest block is freed, if there is no place for new one */
+  if (p->numBlocks == ALLOC_CACHE_MAX_BLOCKS)
+  {
+    unsigned i;
+    SzFreeTemp(NULL, p->blocks[0]);
+    for (i = 1; i < ALLOC_CACHE_MAX_BLOCKS; i++)
+      p->blocks[i - 1] = p->blocks[i];
+    p->numBlocks--;
+  }
+  p->blocks[p->numBlocks++] = block;
+}
+
+static void AllocCache_Init(CAllocCache *p)
+{
+  p->s.Alloc = AllocCache_Alloc;
+  p->s.Free = AllocCache_Free;
+  p->numBlocks = 0;
+}
+
+static void AllocCache_FreeAll(CAllocCache *p)
+{
+  while (p->numBlocks != 0)
+    SzFreeTemp(NULL, p->blocks[--p->numBlocks]);
+}
+
+
+/* Arena allocator for the header of archive: a lot of small blocks of header data
+  are allocated in big chunks, freeing of small block does nothing, and all memory
+  of arena is freed at once by AllocArena_FreeAll. Big blocks get their own chunks,
+  these chunks are freed by AllocArena_Free, so big temporary buffers don't stay */
+#define ALLOC_ARENA_MIN_CHUNK_SIZE (1 << 16)
+#define ALLOC_ARENA_MAX_CHUNK_SIZE (1 << 20)
+#define ALLOC_ARENA_ALIGN 16
+
+typedef struct
+{
+  size_t numBytes;  /* sum of requested sizes */
+  size_t numAllocs;
+  size_t numChunks; /* memory blocks taken from the system */
+} CAllocStat;
+
+typedef struct
+{
+  ISzAlloc s;
+  /* lists of chunks, each chunk starts with the pointer to the next one */
+  Byte *chunks;
+  Byte *bigChunks;
+  Byte *pos;
+  size_t rem;
+  size_t chunkSize;
+  CAllocStat stat;
+} CAllocArena;
+
+#define AllocArena_GetNext(chunk) (*(Byte **)(void *)(chunk))
+
+static Byte *AllocArena_AddChunk(CAllocArena *p, Byte **list, size_t size)
+{
+  Byte *chunk;
+  if (size > (size_t)0 - 1 - ALLOC_ARENA_ALIGN)
+    return 0;
+  chunk = (Byte *)SzAlloc(NULL, size + ALLOC_ARENA_ALIGN);
+  if (chunk == 0)
+    return 0;
+  AllocArena_GetNext(chunk) = *list;
+  *list = chunk;
+  p->stat.numChunks++;
+  return chunk + ALLOC_ARENA_ALIGN;
+}
+
+static void *AllocArena_Alloc(void *pp, size_t size)
+{
+  CAllocArena *p = (CAllocArena *)pp;
+  size_t alignedSize;
+  Byte *res;
+  if (size == 0 || size > (size_t)0 - ALLOC_ARENA_ALIGN)
+    return 0;
+  alignedSize = (size + ALLOC_ARENA_ALIGN - 1) & ~(size_t)(ALLOC_ARENA_ALIGN - 1);
+  if (alignedSize > p->chunkSize / 4)
+    res = AllocArena_AddChunk(p, &p->bigChunks, alignedSize);
+  else if (alignedSize > p->rem)
+  {
+    res = AllocArena_AddChunk(p, &p->chunks, p->chunkSize);
+    if (res != 0)
+    {
+      p->pos = res + alignedSize;
+      p->rem = p->chunkSize - alignedSize;
+      /* the next chunks are bigger, so big headers take a few chunks */
+      if (p->chunkSize < ALLOC_ARENA_MAX_CHUNK_SIZE)
+        p->chunkSize <<= 1;
+    }
+  }
+  else
+  {
+    res = p->pos;
+    p->pos += alignedSize;
+    p->rem -= alignedSize;
+  }
+  if (res == 0)
+    return 0;
+  p->stat.numAllocs++;
+  p->stat.numBytes += size;
+  return res;
+}
+
+static void AllocArena_Free(void *pp, void *address)
+{
+  CAllocArena *p = (CAllocArena *)pp;
+  Byte **next;
+  if (address == 0)
+    return;
+  /* there are only a few big chunks */
+  for (next = &p->bigChunks; *next != NULL; next = &AllocArena_GetNext(*next))
+    if (*next + ALLOC_ARENA_ALIGN == (Byte *)address)
+    {
+      Byte *chunk = *next;
+      *next = AllocArena_GetNext(chunk);
+      SzFree(NULL, chunk);
+      return;
+    }
+}
+
+static void AllocArena_Init(CAllocArena *p)
+{
+  p->s.Alloc = AllocArena_Alloc;
+  p->s.Free = AllocArena_Free;
+  p->chunks = NULL;
+  p->bigChunks = NULL;
+  p->pos = NULL;
+  p->rem = 0;
+  p->chunkSize = ALLOC_ARENA_MIN_CHUNK_SIZE;
+  p->stat.numBytes = 0;
+  p->stat.numAllocs = 0;
+  p->stat.numChunks = 0;
+}
+
+static void AllocArena_FreeList(Byte *chunk)
+{
+  while (chunk != NULL)
+  {
+    Byte *next = AllocArena_GetNext(chunk);
+    SzFree(NULL, chunk);
+    chunk = next;
+  }
+}
+
+static void AllocArena_FreeAll(CAllocArena *p)
+{
+  AllocArena_FreeList(p->chunks);
+  AllocArena_FreeList(p->bigChunks);
+  AllocArena_Init(p);
+}
+
+/* the names of file system are UTF-8 names of archive on non-Windows systems,
+  so the table of UTF-8 names is built, and the names are not converted for each file */
+#ifdef _WIN32
+#define OPEN_FLAGS_FS_NAMES 0
+#define LOAD_FS_NAMES SZ_AR_LOAD_NAMES
+#else
+#define OPEN_FLAGS_FS_NAMES SZ_AR_OPEN_UTF8_NAMES
+#define LOAD_FS_NAMES SZ_AR_LOAD_UTF8_NAMES
+#endif
+
+/* Open archive and fill 'db': the header data is allocated in 'arena' and it's
+  freed with arena, temporary buffers of parsing are in another arena,
+  the numbers of its allocations are returned in 'tempStat',
+  'flags' - the flags of SzArEx_OpenEx */
+static SRes OpenArchiveDb(CSzArEx *db, ILookInStream *inStream, unsigned flags, CAllocArena *arena, CAllocStat *tempStat)
+{
+  CAllocArena arenaTemp;
+  SRes res;
+  AllocArena_Init(&arenaTemp);
+  SzArEx_Init(db);
+  res = SzArEx_OpenEx(db, inStream, flags, &arena->s, &arenaTemp.s);
+  if (tempStat != NULL)
+    *tempStat = arenaTemp.stat;
+  AllocArena_FreeAll(&arenaTemp);
+  return res;
+}
+
+/* Print archive content */
+static SRes List7zSource(const CArchiveSource *src) {
+  CArchiveInStream archiveStream;
+  CSzArEx db;
+  SRes res;
+  CAllocArena arena;
+  UInt16 *temp = NULL;
+  size_t tempSize = 0;
+  CBuf charBuf;
+
+  AllocArena_Init(&arena);
+  Buf_Init(&charBuf);
+
+  /* открыть файл архива */
+  if (ArchiveInStream_Open(&archiveStream, src))
+  {
+    printf("\nERROR: can not open input file");
+    return SZ_ERROR_FAIL;
+  }
+
+  if (src->name != NULL)
+    printf("Contents of archive %s:\n\n", src->name);
+  else
+    printf("Contents of archive in memory:\n\n");
+ 
+
+  /* opening archive & filling 'db' structure */
+  res = OpenArchiveDb(&db, archiveStream.s, OPEN_FLAGS_FS_NAMES, &arena, NULL);
+  if (res == SZ_OK)
+  {
+    UInt32 i;
+
+    /* öèêë ïî âñåì ôàéëàì â àðõèâå */
+    for (i = 0; i < db.db.NumFiles; i++)
+    {
+      const CSzFileItem *f = db.db.Files + i;
+      size_t len;
+      const char *name = SzArEx_GetFileNameUtf8(&db, i, &len);
+      if (name != NULL)
+      {
+        /* the name from the table is printed as is */
+        fwrite(name, 1, len, stdout);
+        printf("\n");
+        continue;
+      }
+      /* óçíàåì ðàçìåð áëîêà ïàìÿòè ïîä ñòðîêó ñ èìåíåì ôàéëà */
+      len = SzArEx_GetFileNameUtf16(&db, i, NULL);
+      /* åñëè íåäîñòàòî÷íî -- âûäåëÿåì áîëüøå ïàìÿòè */
+      if (len > tempSize)
+      {
+        SzFree(NULL, temp);
+        tempSize = len;
+        temp = (UInt16 *)SzAlloc(NULL, tempSize * sizeof(temp[0]));
+        if (temp == 0)
+        {
+          res = SZ_ERROR_MEM;
+          break;
+        }
+      }
+      /* ïîëó÷àåì èìÿ ôàéëà ïî èíäåêñó */
+      SzArEx_GetFileNameUtf16(&db, i, temp);
+      /* âûâîäèì èìÿ ôàéëà */
+      PrintString(temp, &charBuf);
+      printf("\n");
+    }
+  }
+  /* îñâîáîæäàåì çàäåéñòâîâàííóþ äëÿ ðàáîòû äèíàìè÷åñêóþ ïàìÿòü */
+  SzArEx_Free(&db, &arena.s);
+  AllocArena_FreeAll(&arena);
+  SzFree(NULL, temp);
+  Buf_Free(&charBuf, &g_Alloc);
+  /* closing file archive */
+  ArchiveInStream_Close(&archiveStream);
+  return res;
+}
+
+/* Ïîêàçàòü ñîäåðæèìîå àðõèâà archiveFile */
+SRes List7zFiles(char* archiveFile) {
+  CArchiveSource src;
+  src.name = archiveFile;
+  return List7zSource(&src);
+}
+
+/* Print content of archive 'data' of 'size' bytes in memory */
+SRes List7zFilesMem(const void *data, size_t size) {
+  CArchiveSource src;
+  src.name = NULL;
+  src.data = data;
+  src.size = size;
+  return List7zSource(&src);
+}
+
+
+/* Write-behind: the output files are opened, written and closed by the writer thread,
+  while the current thread decodes the next data. The data is copied to the queue of
+  operations, and the size of queued data is limited, so the decoder waits the writer,
+  if the disk is slower */
+#define WRITE_OP_OPEN 0
+#define WRITE_OP_WRITE 1
+#define WRITE_OP_CLOSE 2
+
+typedef struct CWriteOp
+{
+  struct CWriteOp *next;
+  int type;
+  UInt32 fileIndex;
+  size_t size; /* the size of data (file name for WRITE_OP_OPEN), that follows this header */
+} CWriteOp;
+
+#define WriteOp_GetData(op) ((Byte *)(op) + sizeof(CWriteOp))
+
+typedef struct
+{
+  ISeqOutStream s;
+  const CSzArEx *db;
+  size_t maxQueuedSize;
+  CThread thread;
+  CCriticalSection cs;
+  CAutoResetEvent canRead;  /* there are new operations, or the writer must stop */
+  CAutoResetEvent canWrite; /* queued data was written */
+  CWriteOp *head;
+  CWriteOp *tail;
+  size_t queuedSize;
+  Bool stop;
+  SRes res; /* the first error of the writer */
+} CWriteBehind;
+
+static void WriteBehind_SetError(CWriteBehind *p, SRes res)
+{
+  CriticalSection_Enter(&p->cs);
+  if (p->res == SZ_OK)
+    p->res = res;
+  CriticalSection_Leave(&p->cs);
+}
+
+static THREAD_FUNC_DECL WriteBehind_ThreadFunc(void *pp)
+{
+  CWriteBehind *p = (CWriteBehind *)pp;
+  CSzFile file;
+  /* the open operation keeps the name of the current file for its attributes */
+  CWriteOp *openOp = NULL;
+  SRes res = SZ_OK;
+  CBuf charBuf;
+
+  File_Construct(&file);
+  Buf_Init(&charBuf);
+  for (;;)
+  {
+    CWriteOp *op;
+    CriticalSection_Enter(&p->cs);
+    while (p->head == NULL && !p->stop)
+    {
+      CriticalSection_Leave(&p->cs);
+      Event_Wait(&p->canRead);
+      CriticalSection_Enter(&p->cs);
+    }
+    op = p->head;
+    if (op != NULL)
+    {
+      p->head = op->next;
+      if (p->head == NULL)
+        p->tail = NULL;
+    }
+    CriticalSection_Leave(&p->cs);
+    if (op == NULL)
+      break;
+
+    /* after an error, the operations are skipped */
+    if (op->type == WRITE_OP_OPEN)
+    {
+      if (res == SZ_OK && OutFile_OpenUtf16(&file, (const UInt16 *)WriteOp_GetData(op), &charBuf))
+      {
+        printf("\nERROR: can not open output file");
+        res = SZ_ERROR_FAIL;
+      }
+      SzFree(NULL, openOp);
+      openOp = op;
+      op = NULL;
+    }
+    else if (op->type == WRITE_OP_WRITE)
+    {
+      size_t size = op->size;
+      if (res == SZ_OK && (File_Write(&file, WriteOp_GetData(op), &size) != 0 || size != op->size))
+        res = SZ_ERROR_WRITE;
+      CriticalSection_Enter(&p->cs);
+      p->queuedSize -= op->size;
+      CriticalSection_Leave(&p->cs);
+    }
+    else
+    {
+      if (File_Close(&file) && res == SZ_OK)
+      {
+        printf("\nERROR: can not close output file");
+        res = SZ_ERROR_FAIL;
+      }
+      /* setting up file's attributes (Windows only) */
+      #ifdef USE_WINDOWS_FILE
+      if (res == SZ_OK && openOp != NULL && p->db->db.Files[op->fileIndex].AttribDefined)
+        SetFileAttributesW((const WCHAR *)WriteOp_GetData(openOp), p->db->db.Files[op->fileIndex].Attrib);
+      #endif
+      SzFree(NULL, openOp);
+      openOp = NULL;
+    }
+    SzFree(NULL, op);
+    if (res != SZ_OK)
+      WriteBehind_SetError(p, res);
+    Event_Set(&p->canWrite);
+  }
+  File_Close(&file);
+  SzFree(NULL, openOp);
+  Buf_Free(&charBuf, &g_Alloc);
+  return 0;
+}
+
+/* adding operation to the queue, it waits, while the queue is full of data */
+static SRes WriteBehind_Add(CWriteBehind *p, int type, UInt32 fileIndex, const void *data, size_t size)
+{
+  SRes res;
+  CWriteOp *op = (CWriteOp *)SzAlloc(NULL, sizeof(CWriteOp) + size);
+  if (op == 0)
+    return SZ_ERROR_MEM;
+  op->next = NULL;
+  op->type = type;
+  op->fileIndex = fileIndex;
+  op->size = size;
+  if (size != 0)
+    memcpy(WriteOp_GetData(op), data, size);
+  CriticalSection_Enter(&p->cs);
+  if (type == WRITE_OP_WRITE)
+    while (p->res == SZ_OK && p->queuedSize != 0 && p->queuedSize + size > p->maxQueuedSize)
+    {
+      CriticalSection_Leave(&p->cs);
+      Event_Wait(&p->canWrite);
+      CriticalSection_Enter(&p->cs);
+    }
+  res = p->res;
+  if (res == SZ_OK)
+  {
+    if (p->tail != NULL)
+      p->tail->next = op;
+    else
+      p->head = op;
+    p->tail = op;
+    if (type == WRITE_OP_WRITE)
+      p->queuedSize += size;
+  }
+  CriticalSection_Leave(&p->cs);
+  if (res != SZ_OK)
+  {
+    SzFree(NULL, op);
+    return res;
+  }
+  Event_Set(&p->canRead);
+  return SZ_OK;
+}
+
+/* the output stream of the current file */
+static size_t WriteBehind_Write(void *pp, const void *data, size_t size)
+{
+  CWriteBehind *p = (CWriteBehind *)pp;
+  if (size == 0)
+    return 0;
+  return (WriteBehind_Add(p, WRITE_OP_WRITE, 0, data, size) == SZ_OK) ? size : 0;
+}
+
+static SRes WriteBehind_Create(CWriteBehind *p, const CSzArEx *db, size_t maxQueuedSize)
+{
+  WRes wres;
+  p->s.Write = WriteBehind_Write;
+  p->db = db;
+  p->maxQueuedSize = maxQueuedSize;
+  p->head = p->tail = NULL;
+  p->queuedSize = 0;
+  p->stop = False;
+  p->res = SZ_OK;
+  Thread_Construct(&p->thread);
+  Event_Construct(&p->canRead);
+  Event_Construct(&p->canWrite);
+  if (CriticalSection_Init(&p->cs) != 0)
+    return SZ_ERROR_THREAD;
+  wres = AutoResetEvent_CreateNotSignaled(&p->canRead);
+  if (wres == 0)
+    wres = AutoResetEvent_CreateNotSignaled(&p->canWrite);
+  if (wres == 0)
+    wres = Thread_Create(&p->thread, WriteBehind_ThreadFunc, p);
+  if (wres != 0)
+  {
+    Event_Close(&p->canRead);
+    Event_Close(&p->canWrite);
+    CriticalSection_Delete(&p->cs);
+    return SZ_ERROR_THREAD;
+  }
+  return SZ_OK;
+}
+
+/* waiting for the writer to write all queued operations, returns its first error */
+static SRes WriteBehind_Finish(CWriteBehind *p)
+{
+  CriticalSection_Enter(&p->cs);
+  p->stop = True;
+  CriticalSection_Leave(&p->cs);
+  Event_Set(&p->canRead);
+  Thread_Wait(&p->thread);
+  Thread_Close(&p->thread);
+  Event_Close(&p->canRead);
+  Event_Close(&p->canWrite);
+  CriticalSection_Delete(&p->cs);
+  return p->res;
+}
+
+/* the maximum size of queued data of write-behind, 0 - the files are written by decoding thread */
+static size_t g_WriteBehindSize = 0;
+
+
+/* Directory cache: the set of directories, that were created already, so each
+  directory is created one time, instead of one time for each file in it.
+  The paths are stored one after another in 'names', the hash table keeps (index + 1)
+  of path or 0 for empty slot */
+#define DIR_HASH_INIT 0x811C9DC5
+#define DIR_HASH_UPDATE(h, c) (((h) ^ (c)) * 0x01000193)
+
+typedef struct
+{
+  UInt32 *table;
+  UInt32 tableMask;
+  UInt32 *hashes;
+  size_t *offsets;
+  UInt32 num;
+  UInt32 numMax;
+  UInt16 *names;
+  size_t namesPos;
+  size_t namesSize;
+} CDirCache;
+
+static void DirCache_Init(CDirCache *p)
+{
+  p->table = NULL;
+  p->tableMask = 0;
+  p->hashes = NULL;
+  p->offsets = NULL;
+  p->num = p->numMax = 0;
+  p->names = NULL;
+  p->namesPos = p->namesSize = 0;
+}
+
+static void DirCache_Free(CDirCache *p)
+{
+  SzFree(NULL, p->table);
+  SzFree(NULL, p->hashes);
+  SzFree(NULL, p->offsets);
+  SzFree(NULL, p->names);
+  DirCache_Init(p);
+}
+
+static Bool DirCache_Find(const CDirCache *p, const UInt16 *name, size_t len, UInt32 h)
+{
+  UInt32 i;
+  if (p->table == NULL)
+    return False;
+  for (i = h & p->tableMask; p->table[i] != 0; i = (i + 1) & p->tableMask)
+  {
+    UInt32 index = p->table[i] - 1;
+    const UInt16 *name2 = p->names + p->offsets[index];
+    size_t k;
+    if (p->hashes[index] != h)
+      continue;
+    for (k = 0; k < len && name2[k] == name[k]; k++);
+    if (k == len && name2[k] == 0)
+      return True;
+  }
+  return False;
+}
+
+static void *DirCache_Grow(void *data, size_t size, size_t newSize)
+{
+  void *newData = SzAlloc(NULL, newSize);
+  if (newData != NULL && size != 0)
+    memcpy(newData, data, size);
+  SzFree(NULL, data);
+  return newData;
+}
+
+static SRes DirCache_Add(CDirCache *p, const UInt16 *name, size_t len, UInt32 h)
+{
+  UInt32 i;
+  if (p->num == p->numMax)
+  {
+    UInt32 numMax = (p->numMax == 0) ? 64 : p->numMax * 2;
+    UInt32 tableSize = numMax * 2;
+    p->hashes = (UInt32 *)DirCache_Grow(p->hashes, p->num * sizeof(UInt32), numMax * sizeof(UInt32));
+    p->offsets = (size_t *)DirCache_Grow(p->offsets, p->num * sizeof(size_t), numMax * sizeof(size_t));
+    SzFree(NULL, p->table);
+    p->table = (UInt32 *)SzAlloc(NULL, tableSize * sizeof(UInt32));
+    if (p->hashes == NULL || p->offsets == NULL || p->table == NULL)
+    {
+      DirCache_Free(p);
+      return SZ_ERROR_MEM;
+    }
+    p->numMax = numMax;
+    p->tableMask = tableSize - 1;
+    memset(p->table, 0, tableSize * sizeof(UInt32));
+    for (i = 0; i < p->num; i++)
+    {
+      UInt32 j;
+      for (j = p->hashes[i] & p->tableMask; p->table[j] != 0; j = (j + 1) & p->tableMask);
+      p->table[j] = i + 1;
+    }
+  }
+  if (p->namesSize - p->namesPos < len + 1)
+  {
+    size_t namesSize = p->namesSize * 2 + len + 1 + (1 << 12);
+    p->names = (UInt16 *)DirCache_Grow(p->names, p->namesPos * sizeof(UInt16), namesSize * sizeof(UInt16));
+    if (p->names == NULL)
+    {
+      DirCache_Free(p);
+      return SZ_ERROR_MEM;
+    }
+    p->namesSize = namesSize;
+  }
+  memcpy(p->names + p->namesPos, name, len * sizeof(name[0]));
+  p->names[p->namesPos + len] = 0;
+  p->offsets[p->num] = p->namesPos;
+  p->hashes[p->num] = h;
+  p->namesPos += len + 1;
+  for (i = h & p->tableMask; p->table[i] != 0; i = (i + 1) & p->tableMask);
+  p->table[i] = ++p->num;
+  return SZ_OK;
+}
+
+/* creating directory 'name' of 'len' characters (null-terminated), if it's not in the cache,
+  'h' - the hash of name, 'buf' - the buffer for converted name */
+static SRes DirCache_CreateDir(CDirCache *p, const UInt16 *name, size_t len, UInt32 h, CBuf *buf)
+{
+  if (DirCache_Find(p, name, len, h))
+    return SZ_OK;
+  /* the directory can exist already, so errors of creation are ignored, as before */
+  MyCreateDir(name, buf);
+  return DirCache_Add(p, name, len, h);
+}
+
+/* the hash of path for the directory cache: the separators of paths
+  in archive and in file system are the same for it */
+#define DirCache_HashUpdate(h, c) DIR_HASH_UPDATE(h, ((c) == CHAR_PATH_SEPARATOR) ? '/' : (c))
+
+
+/* Extraction callback: writing files of the solid block to the disk */
+typedef struct
+{
+  ISzExtractCallback s;
+  const CSzArEx *db;
+  int fullPaths;
+  UInt16 *name;
+  size_t nameSize;
+  UInt16 *destPath;
+  UInt32 destPathHash; /* the hash of full path for the directory cache */
+  CFileOutStream outStream;
+  /* the files are written by the writer thread, if it's not NULL */
+  CWriteBehind *writeBehind;
+  /* directories are created already by ExtractCallback_CreateDirs */
+  Bool dirsCreated;
+  CDirCache dirCache;
+  CBuf charBuf; /* the converted names for file system */
+  SRes res;
+} CExtractCallback;
+
+/* getting name of the file 'fileIndex' to the 'name' buffer */
+static SRes ExtractCallback_GetName(CExtractCallback *p, UInt32 fileIndex)
+{
+  size_t len;
+  /* memory block size storing file name string */
+  len = SzArEx_GetFileNameUtf16(p->db, fileIndex, NULL);
+  /* allocate additional memory, if that was not enough */
+  if (len > p->nameSize)
+  {
+    SzFree(NULL, p->name);
+    p->nameSize = len;
+    p->name = (UInt16 *)SzAlloc(NULL, p->nameSize * sizeof(p->name[0]));
+    if (p->name == 0)
+    {
+      p->nameSize = 0;
+      return SZ_ERROR_MEM;
+    }
+  }
+  /* getting file name by index */
+  SzArEx_GetFileNameUtf16(p->db, fileIndex, p->name);
+  return SZ_OK;
+}
+
+/* getting name of the file 'fileIndex' and generating its destination path,
+  in case of 'fullPaths==1' sub-directories are created on the way */
+static SRes ExtractCallback_PrepareFile(CExtractCallback *p, UInt32 fileIndex)
+{
+  size_t j;
+  UInt32 h = DIR_HASH_INIT;
+  RINOK(ExtractCallback_GetName(p, fileIndex));
+  p->destPath = p->name;
+  /* generating file name with sub-directories */
+  for (j = 0; p->name[j] != 0; j++)
+  {
+    if (p->name[j] == '/')
+    {
+      if (p->fullPaths)
+      {
+        if (!p->dirsCreated)
+        {
+          SRes res;
+          p->name[j] = 0;
+          res = DirCache_CreateDir(&p->dirCache, p->name, j, h, &p->charBuf);
+          p->name[j] = '/';
+          RINOK(res);
+        }
+        p->name[j] = CHAR_PATH_SEPARATOR;
+      }
+      else
+        p->destPath = p->name + j + 1;
+    }
+    h = DirCache_HashUpdate(h, p->name[j]);
+  }
+  p->destPathHash = h;
+  return SZ_OK;
+}
+
+/* opening output file 'fileIndex' after ExtractCallback_PrepareFile,
+  the UTF-8 name of the table is used, if it's the name of file system */
+static WRes ExtractCallback_OpenFile(CExtractCallback *p, CSzFile *file, UInt32 fileIndex)
+{
+  #ifndef _WIN32
+  size_t len;
+  const char *name = SzArEx_GetFileNameUtf8(p->db, fileIndex, &len);
+  if (name != NULL)
+  {
+    if (p->destPath != p->name)
+    {
+      /* the name without directories */
+      for (; len > 0 && name[len - 1] != '/'; len--);
+      name += len;
+    }
+    return OutFile_Open(file, name);
+  }
+  #else
+  fileIndex = fileIndex;
+  #endif
+  return OutFile_OpenUtf16(file, p->destPath, &p->charBuf);
+}
+
+/* opening output file for the next file of the solid block */
+static ISeqOutStream *ExtractCallback_GetStream(void *pp, UInt32 fileIndex)
+{
+  CExtractCallback *p = (CExtractCallback *)pp;
+  p->res = ExtractCallback_PrepareFile(p, fileIndex);
+  if (p->res != SZ_OK)
+    return NULL;
+  if (p->writeBehind != NULL)
+  {
+    size_t len;
+    for (len = 0; p->destPath[len] != 0; len++);
+    p->res = WriteBehind_Add(p->writeBehind, WRITE_OP_OPEN, fileIndex, p->destPath, (len + 1) * sizeof(p->destPath[0]));
+    return (p->res == SZ_OK) ? &p->writeBehind->s : NULL;
+  }
+  if (ExtractCallback_OpenFile(p, &p->outStream.file, fileIndex))
+  {
+    printf("\nERROR: can not open output file");
+    p->res = SZ_ERROR_FAIL;
+    return NULL;
+  }
+  return &p->outStream.s;
+}
+
+/* closing output file after its last byte was written */
+static SRes ExtractCallback_SetResult(void *pp, UInt32 fileIndex, SRes res)
+{
+  CExtractCallback *p = (CExtractCallback *)pp;
+  if (p->writeBehind != NULL)
+  {
+    /* the writer closes the file, its errors are returned for the next files */
+    SRes res2 = WriteBehind_Add(p->writeBehind, WRITE_OP_CLOSE, fileIndex, NULL, 0);
+    if (res == SZ_OK)
+      res = res2;
+    return (p->res != SZ_OK) ? p->res : res;
+  }
+  /* closing file handler */
+  if (File_Close(&p->outStream.file) && res == SZ_OK)
+  {
+    printf("\nERROR: can not close output file");
+    res = SZ_ERROR_FAIL;
+  }
+  /* setting up file's attributes (Windows only) */
+  #ifdef USE_WINDOWS_FILE
+  if (p->db->db.Files[fileIndex].AttribDefined)
+    SetFileAttributesW(p->destPath, p->db->db.Files[fileIndex].Attrib);
+  #else
+  fileIndex = fileIndex;
+  #endif
+  return (p->res != SZ_OK) ? p->res : res;
+}
+
+/* creating directory or empty file 'fileIndex', which has no data in the solid blocks */
+static SRes ExtractCallback_ExtractEmptyItem(CExtractCallback *p, UInt32 fileIndex)
+{
+  const CSzFileItem *f = p->db->db.Files + fileIndex;
+  CSzFile outFile;
+  RINOK(ExtractCallback_PrepareFile(p, fileIndex));
+  /* in case that is a directory, creating it */
+  if (f->IsDir)
+  {
+    size_t len;
+    if (p->dirsCreated)
+      return SZ_OK;
+    if (p->destPath != p->name)
+    {
+      /* the directory without its parents */
+      MyCreateDir(p->destPath, &p->charBuf);
+      return SZ_OK;
+    }
+    for (len = 0; p->destPath[len] != 0; len++);
+    return DirCache_CreateDir(&p->dirCache, p->destPath, len, p->destPathHash, &p->charBuf);
+  }
+  /* empty file */
+  if (ExtractCallback_OpenFile(p, &outFile, fileIndex))
+  {
+    printf("\nERROR: can not open output file");
+    return SZ_ERROR_FAIL;
+  }
+  /* closing file handler */
+  if (File_Close(&outFile))
+  {
+    printf("\nERROR: can not close output file");
+    return SZ_ERROR_FAIL;
+  }
+  /* setting up file's attributes (Windows only) */
+  #ifdef USE_WINDOWS_FILE
+  if (f->AttribDefined)
+    SetFileAttributesW(p->destPath, f->Attrib);
+  #endif
+  return SZ_OK;
+}
+
+/* Mapped output files: the file, that is the only one in its solid block, is decoded
+  directly to the memory-mapped output file, without the buffer of solid block and
+  without copying of data through the file stream */
+static int g_MapOutFiles = 0;
+/* it's faster to write small files than to map them */
+#define MAP_OUT_MIN_SIZE (1 << 16)
+
+static Bool ExtractCallback_CanMap(const CSzArEx *db, UInt32 folderIndex)
+{
+  UInt64 size;
+  if (!g_MapOutFiles || db->db.Folders[folderIndex].NumUnpackStreams != 1)
+    return False;
+  size = db->db.Files[db->FolderStartFileIndex[folderIndex]].Size;
+  return (Bool)(size >= MAP_OUT_MIN_SIZE && size == (size_t)size);
+}
+
+/* decoding the only file of solid block 'folderIndex' to 'dest' of the file's size */
+static SRes DecodeSingleFileFolder(const CSzArEx *db, ILookInStream *inStream,
+    UInt32 folderIndex, Byte *dest, size_t size, ISzAlloc *allocTemp)
+{
+  const CSzFolder *folder = db->db.Folders + folderIndex;
+  const CSzFileItem *f = db->db.Files + db->FolderStartFileIndex[folderIndex];
+  UInt64 startPos = SzArEx_GetFolderStreamPos(db, folderIndex, 0);
+  UInt32 crc, fileCrc;
+  RINOK(LookInStream_SeekTo(inStream, startPos));
+  RINOK(SzFolder_DecodeCrc(folder,
+      db->db.PackSizes + db->FolderStartPackStreamIndex[folderIndex],
+      inStream, startPos, dest, size, allocTemp,
+      0, size, &crc, &fileCrc));
+  if ((folder->UnpackCRCDefined && crc != folder->UnpackCRC) ||
+      (f->CrcDefined && fileCrc != f->Crc))
+    return SZ_ERROR_CRC;
+  return SZ_OK;
+}
+
+/* decoding the only file of solid block 'folderIndex' to the mapped output file,
+  'mapped==False' - the file can not be mapped, and it's not extracted */
+static SRes ExtractCallback_ExtractMapped(CExtractCallback *p, ILookInStream *inStream,
+    UInt32 folderIndex, ISzAlloc *allocTemp, Bool *mapped)
+{
+  const CSzArEx *db = p->db;
+  UInt32 fileIndex = db->FolderStartFileIndex[folderIndex];
+  CFileMapOut map;
+  SRes res;
+
+  *mapped = False;
+  if (ExtractCallback_GetStream(p, fileIndex) == NULL)
+    return p->res;
+  if (FileMapOut_Open(&map, &p->outStream.file, db->db.Files[fileIndex].Size) != 0)
+  {
+    /* the file will be written through the file stream */
+    File_Close(&p->outStream.file);
+    return SZ_OK;
+  }
+  *mapped = True;
+  res = DecodeSingleFileFolder(db, inStream, folderIndex, map.data, map.size, allocTemp);
+  if (FileMapOut_Close(&map) != 0 && res == SZ_OK)
+  {
+    printf("\nERROR: can not write output file");
+    res = SZ_ERROR_FAIL;
+  }
+  return ExtractCallback_SetResult(p, fileIndex, res);
+}
+
+/* initializing extraction callback */
+static void ExtractCallback_Init(CExtractCallback *p, const CSzArEx *db, int fullPaths)
+{
+  p->s.GetStream = ExtractCallback_GetStream;
+  p->s.SetResult = ExtractCallback_SetResult;
+  p->db = db;
+  p->fullPaths = fullPaths;
+  p->name = NULL;
+  p->nameSize = 0;
+  p->writeBehind = NULL;
+  p->dirsCreated = False;
+  DirCache_Init(&p->dirCache);
+  Buf_Init(&p->charBuf);
+  p->res = SZ_OK;
+  FileOutStream_CreateVTable(&p->outStream);
+  File_Construct(&p->outStream.file);
+}
+
+static void ExtractCallback_Free(CExtractCallback *p)
+{
+  SzFree(NULL, p->name);
+  p->name = NULL;
+  p->nameSize = 0;
+  DirCache_Free(&p->dirCache);
+  Buf_Free(&p->charBuf, &g_Alloc);
+}
+
+/* creating all directories of the archive and the parent directories of all files
+  before the extraction, so the extraction doesn't create directories */
+static SRes ExtractCallback_CreateDirs(CExtractCallback *p)
+{
+  UInt32 i;
+  if (!p->fullPaths)
+    return SZ_OK;
+  for (i = 0; i < p->db->db.NumFiles; i++)
+  {
+    if (p->db->db.Files[i].IsDir)
+    {
+      RINOK(ExtractCallback_ExtractEmptyItem(p, i));
+    }
+    else
+    {
+      RINOK(ExtractCallback_PrepareFile(p, i));
+    }
+  }
+  /* the cache is not needed anymore */
+  DirCache_Free(&p->dirCache);
+  p->dirsCreated = True;
+  return SZ_OK;
+}
+
+/* Extract archive,
+  if used with 'fullPaths==1' - it will keep directories structure */ 
+static SRes Decode7zSource(const CArchiveSource *src, int fullPaths) {
+  CArchiveInStream archiveStream;
+  CSzArEx db;
+  SRes res;
+  CAllocArena arena;
+  CAllocCache allocCache;
+  CExtractCallback extractCallback;
+  CWriteBehind writeBehind;
+
+  AllocArena_Init(&arena);
+  AllocCache_Init(&allocCache);
+
+  /* opening archive file */
+  if (ArchiveInStream_Open(&archiveStream, src))
+  {
+    printf("\nERROR: can not open input file");
+    return SZ_ERROR_FAIL;
+  }
+
+
+  /* initializing extraction callback */
+  ExtractCallback_Init(&extractCallback, &db, fullPaths);
+
+  /* opening archive & filling 'db' structure */
+  res = OpenArchiveDb(&db, archiveStream.s, OPEN_FLAGS_FS_NAMES, &arena, NULL);
+  /* the directory tree is created from the header before the decoding */
+  if (res == SZ_OK)
+    res = ExtractCallback_CreateDirs(&extractCallback);
+  /* starting the writer thread, the files are written while next data is decoded */
+  if (res == SZ_OK && g_WriteBehindSize != 0)
+  {
+    res = WriteBehind_Create(&writeBehind, &db, g_WriteBehindSize);
+    if (res == SZ_OK)
+      extractCallback.writeBehind = &writeBehind;
+  }
+  if (res == SZ_OK)
+  {
+    UInt32 i;
+
+    /* öèêë ïî âñåì ôàéëàì â àðõèâå */
+    for (i = 0; i < db.db.NumFiles; i++)
+    {
+      const CSzFileItem *f = db.db.Files + i;
+
+      /* åñëè ýòî êàòàëîã è íå íóæíî âîññîçäàâàòü ñòðóêòóðó ïîäêàòàëîãîâ
+         -- ïðîïóñêàåì */
+      if (f->IsDir && !fullPaths)
+        continue;
+      /*
+       the file with data: solid block is unpacked at its first file through
+       the dictionary-sized window and all of its files are written on the way
+      */
+      if (f->HasStream)
+      {
+        UInt32 folderIndex = db.FileIndexToFolderIndexMap[i];
+        Bool mapped = False;
+        if (db.FolderStartFileIndex[folderIndex] != i)
+          continue;
+        ArchiveInStream_PrefetchFolder(&archiveStream, &db, folderIndex);
+        if (extractCallback.writeBehind == NULL && ExtractCallback_CanMap(&db, folderIndex))
+          res = ExtractCallback_ExtractMapped(&extractCallback, archiveStream.s, folderIndex, &allocCache.s, &mapped);
+        if (!mapped && res == SZ_OK)
+          res = SzArEx_ExtractFolder(&db, archiveStream.s, folderIndex,
+              &extractCallback.s, &allocCache.s);
+        /* the error of writer thread is reported, when it's stopped */
+        if (res == SZ_ERROR_WRITE && extractCallback.writeBehind == NULL)
+        {
+          printf("\nERROR: can not write output file");
+          res = SZ_ERROR_FAIL;
+        }
+        if (res != SZ_OK)
+          break;
+        continue;
+      }
+      /* directory or empty file */
+      res = ExtractCallback_ExtractEmptyItem(&extractCallback, i);
+      if (res != SZ_OK)
+        break;
+    }
+  }
+  if (extractCallback.writeBehind != NULL)
+  {
+    SRes res2 = WriteBehind_Finish(&writeBehind);
+    if (res2 != SZ_OK)
+      res = res2;
+    if (res == SZ_ERROR_WRITE)
+    {
+      printf("\nERROR: can not write output file");
+      res = SZ_ERROR_FAIL;
+    }
+  }
+  SzArEx_Free(&db, &arena.s);
+  AllocArena_FreeAll(&arena);
+  AllocCache_FreeAll(&allocCache);
+  ExtractCallback_Free(&extractCallback);
+  /* closing file archive */
+  ArchiveInStream_Close(&archiveStream);
+  return res;
+}
+
+/* Extract archive 'archiveFile'
+  if used with 'fullPaths==1' - it will keep directories structure */ 
+SRes Decode7zFiles(char* archiveFile, int fullPaths) {
+  CArchiveSource src;
+  src.name = archiveFile;
+  return Decode7zSource(&src, fullPaths);
+}
+
+/* Extract archive 'data' of 'size' bytes in memory */
+SRes Decode7zFilesMem(const void *data, size_t size, int fullPaths) {
+  CArchiveSource src;
+  src.name = NULL;
+  src.data = data;
+  src.size = size;
+  return Decode7zSource(&src, fullPaths);
+}
+
+
+/* Entry of listing, that is made from the archive header without decoding */
+typedef struct C7zListEntry
+{
+  const char *name; /* full path in archive, UTF-8 with '/' separators */
+  size_t nameLen;
+  unsigned long long size;
+  unsigned long long mtime; /* FILETIME: 100-ns intervals since 1601, if 'mtimeDefined' */
+  unsigned folder; /* solid block of data, (unsigned)-1 for directories and empty files */
+  unsigned crc; /* CRC32 of data, if 'crcDefined' */
+  unsigned attrib; /* Windows attributes, if 'attribDefined' */
+  unsigned char crcDefined;
+  unsigned char mtimeDefined;
+  unsigned char attribDefined;
+  unsigned char isDir;
+} C7zListEntry;
+
+#define LIST7Z_FORMAT_TSV 0
+#define LIST7Z_FORMAT_JSON 1
+
+/* Archive handle: the archive stays open with parsed header, the last decoded
+  solid block and the tables of decoders are kept between extractions */
+typedef struct C7zArchive
+{
+  CArchiveInStream archiveStream;
+  CSzArEx db;
+  /* header data and the numbers of allocations of header parsing */
+  CAllocArena arena;
+  CAllocStat tempStat;
+  CAllocCache allocCache;
+  CExtractCallback extractCallback;
+  /* widechar name for the lookup in archive */
+  CBuf nameBuf;
+  /* solid block cache of SzArEx_Extract */
+  UInt32 blockIndex;
+  Byte *outBuffer;
+  size_t outBufferSize;
+  /* entries of Get7zListEntries, they are made at the first call */
+  C7zListEntry *listEntries;
+  /* the mapped index file, if the archive is opened from the index cache */
+  CFileMapInStream indexStream;
+} C7zArchive;
+
+/* Close archive handle and free all its memory */
+void Close7zArchive(C7zArchive *p) {
+  if (p == NULL)
+    return;
+  IAlloc_Free(&p->allocCache.s, p->outBuffer);
+  SzArEx_Free(&p->db, &p->arena.s);
+  AllocArena_FreeAll(&p->arena);
+  FileMapInStream_Close(&p->indexStream);
+  ExtractCallback_Free(&p->extractCallback);
+  Buf_Free(&p->nameBuf, &g_Alloc);
+  SzFree(NULL, p->listEntries);
+  AllocCache_FreeAll(&p->allocCache);
+  /* closing file archive */
+  ArchiveInStream_Close(&p->archiveStream);
+  SzFree(NULL, p);
+}
+
+/* Read the data of header 'props' (SZ_AR_LOAD_*), if it's not read yet:
+  it's allocated in the arena of header */
+static SRes Archive_Load(C7zArchive *p, unsigned props) {
+  return SzArEx_Load(&p->db, props, &p->arena.s, &g_Alloc);
+}
+
+/* Index cache: the parsed header of archive file is written to the index file
+  in the directory 'g_IndexCacheDir' at the first open of archive, and the next
+  opens of that archive map the index file instead of reading and decoding of header.
+  The key of index is the name, the size, the modification time and the start header
+  of archive (it contains CRC of header), so the index of changed archive is not used */
+static const char *g_IndexCacheDir = NULL;
+
+#define INDEX_KEY_NAME_POS (16 + k7zStartHeaderSize)
+
+static SRes IndexCache_GetKey(C7zArchive *p, const char *name, CBuf *key)
+{
+  ILookInStream *stream = p->archiveStream.s;
+  size_t nameLen = strlen(name);
+  Int64 size = 0;
+  UInt64 mtime;
+  #ifdef _WIN32
+  struct _stati64 st;
+  if (_stati64(name, &st) != 0)
+    return SZ_ERROR_READ;
+  #else
+  struct stat st;
+  if (stat(name, &st) != 0)
+    return SZ_ERROR_READ;
+  #endif
+  mtime = (UInt64)st.st_mtime;
+  RINOK(stream->Seek(stream, &size, SZ_SEEK_END));
+  if (!Buf_EnsureSize(key, INDEX_KEY_NAME_POS + nameLen))
+    return SZ_ERROR_MEM;
+  SetUi32(key->data, (UInt32)size);
+  SetUi32(key->data + 4, (UInt32)((UInt64)size >> 32));
+  SetUi32(key->data + 8, (UInt32)mtime);
+  SetUi32(key->data + 12, (UInt32)(mtime >> 32));
+  RINOK(LookInStream_SeekTo(stream, 0));
+  RINOK(LookInStream_Read(stream, key->data + 16, k7zStartHeaderSize));
+  memcpy(key->data + INDEX_KEY_NAME_POS, name, nameLen);
+  key->size = INDEX_KEY_NAME_POS + nameLen;
+  return SZ_OK;
+}
+
+/* the name of index file: FNV-1a hash of the name of archive */
+static SRes IndexCache_GetName(const char *name, CBuf *indexName)
+{
+  UInt32 hi = 0xCBF29CE4, lo = 0x84222325;
+  size_t dirLen = strlen(g_IndexCacheDir);
+  for (; *name != 0; name++)
+  {
+    /* 64-bit multiplication by 0x100000001B3 in 32-bit parts */
+    UInt64 m;
+    lo ^= (Byte)*name;
+    m = (UInt64)lo * 0x1B3;
+    hi = hi * 0x1B3 + (lo << 8) + (UInt32)(m >> 32);
+    lo = (UInt32)m;
+  }
+  if (!Buf_EnsureSize(indexName, dirLen + 32))
+    return SZ_ERROR_MEM;
+  sprintf((char *)indexName->data, "%s%c%08X%08X.7zi", g_IndexCacheDir, CHAR_PATH_SEPARATOR, hi, lo);
+  return SZ_OK;
+}
+
+/* writing the index to the temporary file, that replaces the index file,
+  so other processes see the whole index or no index */
+static SRes IndexCache_Write(C7zArchive *p, const char *indexName, const CBuf *key)
+{
+  CFileOutStream outStream;
+  char *tempName;
+  SRes res;
+  int closeRes;
+
+  RINOK(Archive_Load(p, SZ_AR_LOAD_NAME_HASH | SZ_AR_LOAD_UTF8_NAMES | SZ_AR_LOAD_MTIME | SZ_AR_LOAD_ATTRIB));
+  tempName = (char *)SzAlloc(NULL, strlen(indexName) + 32);
+  if (tempName == 0)
+    return SZ_ERROR_MEM;
+  #ifdef _WIN32
+  sprintf(tempName, "%s.%u.%lX.tmp", indexName, (unsigned)_getpid(), (unsigned long)(size_t)p);
+  #else
+  sprintf(tempName, "%s.%u.%lX.tmp", indexName, (unsigned)getpid(), (unsigned long)(size_t)p);
+  #endif
+  if (OutFile_Open(&outStream.file, tempName) != 0)
+  {
+    SzFree(NULL, tempName);
+    return SZ_ERROR_WRITE;
+  }
+  FileOutStream_CreateVTable(&outStream);
+  res = SzArEx_WriteIndex(&p->db, key->data, key->size, &outStream.s);
+  closeRes = File_Close(&outStream.file);
+  if (res == SZ_OK && closeRes != 0)
+    res = SZ_ERROR_WRITE;
+  #ifdef _WIN32
+  if (res == SZ_OK && !MoveFileExA(tempName, indexName, MOVEFILE_REPLACE_EXISTING))
+    res = SZ_ERROR_WRITE;
+  #else
+  if (res == SZ_OK && rename(tempName, indexName) != 0)
+    res = SZ_ERROR_WRITE;
+  #endif
+  if (res != SZ_OK)
+    remove(tempName);
+  SzFree(NULL, tempName);
+  return res;
+}
+
+/* Open archive file 'name' from the index cache, the archive is opened by parsing
+  of its header, if there is no index or it's the index of other archive or other
+  version of archive. The index is written then, the errors of index are not reported */
+static SRes Archive_OpenCached(C7zArchive *p, const char *name)
+{
+  CBuf key, indexName;
+  SRes res;
+  Bool useIndex;
+
+  Buf_Init(&key);
+  Buf_Init(&indexName);
+  useIndex = (Bool)(IndexCache_GetKey(p, name, &key) == SZ_OK &&
+      IndexCache_GetName(name, &indexName) == SZ_OK);
+  if (useIndex && FileMapInStream_Open(&p->indexStream, (const char *)indexName.data) == 0)
+  {
+    if (SzArEx_OpenIndex(&p->db, p->indexStream.mem.data, p->indexStream.mem.size,
+        key.data, key.size, &p->arena.s) == SZ_OK)
+    {
+      Buf_Free(&key, &g_Alloc);
+      Buf_Free(&indexName, &g_Alloc);
+      return SZ_OK;
+    }
+    FileMapInStream_Close(&p->indexStream);
+  }
+  /* the reading of key could stop at any position */
+  res = LookInStream_SeekTo(p->archiveStream.s, 0);
+  if (res == SZ_OK)
+    res = OpenArchiveDb(&p->db, p->archiveStream.s, SZ_AR_OPEN_LAZY, &p->arena, &p->tempStat);
+  if (res == SZ_OK && useIndex)
+    IndexCache_Write(p, (const char *)indexName.data, &key);
+  Buf_Free(&key, &g_Alloc);
+  Buf_Free(&indexName, &g_Alloc);
+  return res;
+}
+
+/* Open archive and parse its header */
+static SRes Open7zSource(const CArchiveSource *src, C7zArchive **archive) {
+  C7zArchive *p;
+  SRes res;
+
+  *archive = NULL;
+  p = (C7zArchive *)SzAlloc(NULL, sizeof(C7zArchive));
+  if (p == 0)
+    return SZ_ERROR_MEM;
+  /* opening archive file */
+  if (ArchiveInStream_Open(&p->archiveStream, src))
+  {
+    printf("\nERROR: can not open input file");
+    SzFree(NULL, p);
+    return SZ_ERROR_FAIL;
+  }
+  AllocArena_Init(&p->arena);
+  AllocCache_Init(&p->allocCache);
+  ExtractCallback_Init(&p->extractCallback, &p->db, 0);
+  Buf_Init(&p->nameBuf);
+  p->blockIndex = 0xFFFFFFFF;
+  p->outBuffer = 0;
+  p->outBufferSize = 0;
+  p->listEntries = NULL;
+  FileMapInStream_Construct(&p->indexStream);
+  memset(&p->tempStat, 0, sizeof(p->tempStat));
+
+  /* opening archive & filling 'db' structure */
+  /* the names, times and attributes are read at the first use (Archive_Load) */
+  if (src->name != NULL && g_IndexCacheDir != NULL)
+    res = Archive_OpenCached(p, src->name);
+  else
+    res = OpenArchiveDb(&p->db, p->archiveStream.s, SZ_AR_OPEN_LAZY, &p->arena, &p->tempStat);
+  if (res != SZ_OK)
+  {
+    Close7zArchive(p);
+    return res;
+  }
+  *archive = p;
+  return SZ_OK;
+}
+
+/* Open archive 'archiveFile' and parse its header */
+SRes Open7zArchive(char* archiveFile, C7zArchive **archive) {
+  CArchiveSource src;
+  src.name = archiveFile;
+  return Open7zSource(&src, archive);
+}
+
+/* Open archive 'data' of 'size' bytes in memory, the memory must stay valid until Close7zArchive */
+SRes Open7zArchiveMem(const void *data, size_t size, C7zArchive **archive) {
+  CArchiveSource src;
+  src.name = NULL;
+  src.data = data;
+  src.size = size;
+  return Open7zSource(&src, archive);
+}
+
+/* Number of files and directories in archive */
+unsigned Get7zNumFiles(C7zArchive *p) {
+  return p->db.db.NumFiles;
+}
+
+/* Memory of header: 'temp==0' - the data of opened archive, with the data of Archive_Load,
+  'temp==1' - the temporary buffers of header parsing */
+void Get7zHeaderMemStat(C7zArchive *p, int temp, size_t *numBytes, size_t *numAllocs, size_t *numChunks) {
+  const CAllocStat *stat = temp ? &p->tempStat : &p->arena.stat;
+  *numBytes = stat->numBytes;
+  *numAllocs = stat->numAllocs;
+  *numChunks = stat->numChunks;
+}
+
+/* Index of file 'fileName' (full path in archive, '/' is separator), -1 if there is no such file */
+int Find7zFile(C7zArchive *p, char* fileName) {
+  size_t len;
+  UInt32 fileIndex;
+  if (Char_To_Utf16(&p->nameBuf, fileName, &len) != 0)
+    return -1;
+  if (Archive_Load(p, SZ_AR_LOAD_NAME_HASH) != SZ_OK)
+    return -1;
+  /* hash lookup, without converting of file names in archive */
+  fileIndex = SzArEx_FindFile(&p->db, (const UInt16 *)p->nameBuf.data, len, 0, 0);
+  return (fileIndex == (UInt32)-1) ? -1 : (int)fileIndex;
+}
+
+/* 'True' - the data of file 'fileIndex' is in the solid block cache,
+  the cache can keep only the part of block up to the end of some file */
+static Bool Archive_IsFileCached(const C7zArchive *p, UInt32 fileIndex)
+{
+  return (Bool)(p->outBuffer != 0 &&
+      p->blockIndex == p->db.FileIndexToFolderIndexMap[fileIndex] &&
+      p->db.FileUnpackPos[fileIndex] + p->db.db.Files[fileIndex].Size <= p->outBufferSize);
+}
+
+/* Extract file 'fileIndex' of opened archive,
+  if used with 'fullPaths==1' - it will create its directories */
+SRes Extract7zFile(C7zArchive *p, unsigned fileIndex, int fullPaths) {
+  CExtractCallback *extractCallback = &p->extractCallback;
+  ISeqOutStream *outStream;
+  size_t offset = 0;
+  size_t outSizeProcessed = 0;
+  SRes res;
+
+  if (fileIndex >= p->db.db.NumFiles)
+    return SZ_ERROR_PARAM;
+  RINOK(Archive_Load(p, LOAD_FS_NAMES | SZ_AR_LOAD_ATTRIB));
+  extractCallback->fullPaths = fullPaths;
+  extractCallback->res = SZ_OK;
+  /* directory or empty file: the cached solid block is not touched */
+  if (!p->db.db.Files[fileIndex].HasStream)
+    return ExtractCallback_ExtractEmptyItem(extractCallback, fileIndex);
+  /* the only file of solid block can be decoded to the mapped output file */
+  if (ExtractCallback_CanMap(&p->db, p->db.FileIndexToFolderIndexMap[fileIndex]))
+  {
+    Bool mapped;
+    ArchiveInStream_PrefetchFolder(&p->archiveStream, &p->db, p->db.FileIndexToFolderIndexMap[fileIndex]);
+    res = ExtractCallback_ExtractMapped(extractCallback, p->archiveStream.s,
+        p->db.FileIndexToFolderIndexMap[fileIndex], &p->allocCache.s, &mapped);
+    if (mapped || res != SZ_OK)
+      return res;
+  }
+  /* unpacking to the solid block buffer, if it's not there already */
+  res = SzArEx_Extract(&p->db, p->archiveStream.s, fileIndex,
+      &p->blockIndex, &p->outBuffer, &p->outBufferSize,
+      &offset, &outSizeProcessed,
+      &p->allocCache.s, &p->allocCache.s);
+  if (res != SZ_OK)
+  {
+    /* the block can be partially decoded */
+    p->blockIndex = 0xFFFFFFFF;
+    return res;
+  }
+  outStream = ExtractCallback_GetStream(extractCallback, fileIndex);
+  if (outStream == NULL)
+    return extractCallback->res;
+  /* writing the file from the solid block buffer */
+  if (outStream->Write(outStream, p->outBuffer + offset, outSizeProcessed) != outSizeProcessed)
+  {
+    printf("\nERROR: can not write output file");
+    res = SZ_ERROR_FAIL;
+  }
+  return ExtractCallback_SetResult(extractCallback, fileIndex, res);
+}
+
+/* Extract file 'fileName' (full path in archive) of opened archive */
+SRes Extract7zFileByName(C7zArchive *p, char* fileName, int fullPaths) {
+  int fileIndex = Find7zFile(p, fileName);
+  if (fileIndex < 0)
+    return SZ_ERROR_PARAM;
+  return Extract7zFile(p, (unsigned)fileIndex, fullPaths);
+}
+
+
+/* Extraction callback of the batch: only the requested files of the solid block are written */
+typedef struct
+{
+  ISzExtractCallback s;
+  CExtractCallback *extractCallback;
+  const UInt32 *fileIndexes; /* sorted requested files of the solid block */
+  UInt32 numFiles;
+  UInt32 pos;
+  Bool fileIsOpen;
+} CExtractBatch;
+
+static ISeqOutStream *ExtractBatch_GetStream(void *pp, UInt32 fileIndex)
+{
+  CExtractBatch *p = (CExtractBatch *)pp;
+  ISeqOutStream *stream;
+  p->fileIsOpen = False;
+  if (p->pos == p->numFiles || p->fileIndexes[p->pos] != fileIndex)
+    return NULL;
+  p->pos++;
+  stream = ExtractCallback_GetStream(p->extractCallback, fileIndex);
+  p->fileIsOpen = (Bool)(stream != NULL);
+  return stream;
+}
+
+static SRes ExtractBatch_SetResult(void *pp, UInt32 fileIndex, SRes res)
+{
+  CExtractBatch *p = (CExtractBatch *)pp;
+  if (!p->fileIsOpen)
+    return (p->extractCallback->res != SZ_OK) ? p->extractCallback->res : res;
+  p->fileIsOpen = False;
+  return ExtractCallback_SetResult(p->extractCallback, fileIndex, res);
+}
+
+static int MY_CDECL CompareFileIndexes(const void *a, const void *b)
+{
+  UInt32 i1 = *(const UInt32 *)a;
+  UInt32 i2 = *(const UInt32 *)b;
+  return (i1 < i2) ? -1 : (i1 > i2) ? 1 : 0;
+}
+
+/* Extract 'numFiles' files 'fileIndexes' of opened archive:
+  files are sorted by solid block and offset in it, so each solid block
+  is decoded one time and only up to its last requested file */
+SRes Extract7zFiles(C7zArchive *p, const unsigned *fileIndexes, unsigned numFiles, int fullPaths) {
+  CExtractCallback *extractCallback = &p->extractCallback;
+  CExtractBatch batch;
+  UInt32 *indexes;
+  UInt32 num = 0, i;
+  SRes res = SZ_OK;
+
+  if (numFiles == 0)
+    return SZ_OK;
+  for (i = 0; i < numFiles; i++)
+    if (fileIndexes[i] >= p->db.db.NumFiles)
+      return SZ_ERROR_PARAM;
+  RINOK(Archive_Load(p, LOAD_FS_NAMES | SZ_AR_LOAD_ATTRIB));
+  indexes = (UInt32 *)SzAlloc(NULL, numFiles * sizeof(indexes[0]));
+  if (indexes == 0)
+    return SZ_ERROR_MEM;
+  for (i = 0; i < numFiles; i++)
+    indexes[i] = fileIndexes[i];
+  /* files of solid block follow in order of their data in the block */
+  qsort(indexes, numFiles, sizeof(indexes[0]), CompareFileIndexes);
+
+  /* directories and empty files go first, they have no data in solid blocks */
+  for (i = 0; i < numFiles && res == SZ_OK; i++)
+  {
+    if (i != 0 && indexes[i - 1] == indexes[i])
+      continue;
+    if (p->db.db.Files[indexes[i]].HasStream)
+      indexes[num++] = indexes[i];
+    else
+      res = Extract7zFile(p, indexes[i], fullPaths);
+  }
+
+  extractCallback->fullPaths = fullPaths;
+  batch.s.GetStream = ExtractBatch_GetStream;
+  batch.s.SetResult = ExtractBatch_SetResult;
+  batch.extractCallback = extractCallback;
+
+  for (i = 0; i < num && res == SZ_OK;)
+  {
+    UInt32 fileIndex = indexes[i];
+    UInt32 folderIndex = p->db.FileIndexToFolderIndexMap[fileIndex];
+    UInt32 last;
+    extractCallback->res = SZ_OK;
+    /* the file that is in the cache already, or the file that is decoded to the mapped file */
+    if (Archive_IsFileCached(p, fileIndex) || ExtractCallback_CanMap(&p->db, folderIndex))
+    {
+      res = Extract7zFile(p, fileIndex, fullPaths);
+      i++;
+      continue;
+    }
+    /* requested files of that solid block */
+    for (last = i + 1; last < num && p->db.FileIndexToFolderIndexMap[indexes[last]] == folderIndex; last++);
+    batch.fileIndexes = indexes + i;
+    batch.numFiles = last - i;
+    batch.pos = 0;
+    batch.fileIsOpen = False;
+    ArchiveInStream_PrefetchFolder(&p->archiveStream, &p->db, folderIndex);
+    res = SzArEx_ExtractFolderPart(&p->db, p->archiveStream.s, folderIndex,
+        indexes[last - 1], &batch.s, &p->allocCache.s);
+    if (res == SZ_ERROR_WRITE)
+    {
+      printf("\nERROR: can not write output file");
+      res = SZ_ERROR_FAIL;
+    }
+    i = last;
+  }
+  SzFree(NULL, indexes);
+  return res;
+}
+
+/* Extract 'numFiles' files 'fileNames' (full paths in archive) of opened archive */
+SRes Extract7zFilesByName(C7zArchive *p, char **fileNames, unsigned numFiles, int fullPaths) {
+  unsigned *fileIndexes;
+  unsigned i;
+  SRes res;
+
+  if (numFiles == 0)
+    return SZ_OK;
+  fileIndexes = (unsigned *)SzAlloc(NULL, numFiles * sizeof(fileIndexes[0]));
+  if (fileIndexes == 0)
+    return SZ_ERROR_MEM;
+  for (i = 0; i < numFiles; i++)
+  {
+    int fileIndex = Find7zFile(p, fileNames[i]);
+    if (fileIndex < 0)
+      break;
+    fileIndexes[i] = (unsigned)fileIndex;
+  }
+  res = (i == numFiles) ? Extract7zFiles(p, fileIndexes, numFiles, fullPaths) : SZ_ERROR_PARAM;
+  SzFree(NULL, fileIndexes);
+  return res;
+}
+
+
+/* Extraction to memory: the decoded data of files are passed to the callbacks
+  of the caller instead of writing to the disk. These types are declared in
+  7ZipUnpackWrapper.h the same way */
+typedef struct C7zFileInfo
+{
+  unsigned index;
+  const char *name; /* full path in archive, UTF-8 */
+  unsigned long long size;
+  unsigned attrib;
+  int attribDefined;
+  int isDir;
+} C7zFileInfo;
+
+typedef struct C7zMemCallback
+{
+  void *ctx;
+  int (*Begin)(void *ctx, const C7zFileInfo *info, int *skip);
+  int (*Data)(void *ctx, unsigned fileIndex, const void *data, size_t size);
+  int (*End)(void *ctx, unsigned fileIndex, int res);
+} C7zMemCallback;
+
+typedef struct
+{
+  ISeqOutStream s;
+  struct CMemExtract *extract;
+} CMemExtractOutStream;
+
+typedef struct CMemExtract
+{
+  ISzExtractCallback s;
+  CMemExtractOutStream outStream;
+  C7zArchive *archive;
+  const C7zMemCallback *callback;
+  const UInt32 *fileIndexes; /* sorted requested files of the solid block */
+  UInt32 numFiles;
+  UInt32 pos;
+  UInt32 fileIndex;
+  Bool fileIsOpen;
+  SRes res; /* the error of the caller's callback */
+} CMemExtract;
+
+/* calling Begin for the file, '*skip==True' - its data is not needed */
+static SRes MemExtract_Begin(CMemExtract *p, UInt32 fileIndex, Bool *skip)
+{
+  const CSzFileItem *f = p->archive->db.db.Files + fileIndex;
+  C7zFileInfo info;
+  size_t len;
+  int skip2 = 0;
+  info.index = fileIndex;
+  /* the archive is opened with the table of UTF-8 names */
+  info.name = SzArEx_GetFileNameUtf8(&p->archive->db, fileIndex, &len);
+  info.size = f->Size;
+  info.attrib = f->Attrib;
+  info.attribDefined = f->AttribDefined;
+  info.isDir = f->IsDir;
+  p->res = p->callback->Begin(p->callback->ctx, &info, &skip2);
+  *skip = (Bool)(skip2 != 0);
+  return p->res;
+}
+
+static SRes MemExtract_End(CMemExtract *p, UInt32 fileIndex, SRes res)
+{
+  SRes res2 = p->callback->End(p->callback->ctx, fileIndex, res);
+  if (res2 != SZ_OK)
+    p->res = res2;
+  return (res2 != SZ_OK) ? res2 : res;
+}
+
+static size_t MemExtract_Write(void *pp, const void *data, size_t size)
+{
+  CMemExtract *p = ((CMemExtractOutStream *)pp)->extract;
+  if (size == 0)
+    return 0;
+  p->res = p->callback->Data(p->callback->ctx, p->fileIndex, data, size);
+  return (p->res == SZ_OK) ? size : 0;
+}
+
+static ISeqOutStream *MemExtract_GetStream(void *pp, UInt32 fileIndex)
+{
+  CMemExtract *p = (CMemExtract *)pp;
+  Bool skip;
+  p->fileIsOpen = False;
+  if (p->pos == p->numFiles || p->fileIndexes[p->pos] != fileIndex)
+    return NULL;
+  p->pos++;
+  if (MemExtract_Begin(p, fileIndex, &skip) != SZ_OK || skip)
+    return NULL;
+  p->fileIndex = fileIndex;
+  p->fileIsOpen = True;
+  return &p->outStream.s;
+}
+
+static SRes MemExtract_SetResult(void *pp, UInt32 fileIndex, SRes res)
+{
+  CMemExtract *p = (CMemExtract *)pp;
+  if (!p->fileIsOpen)
+    return (p->res != SZ_OK) ? p->res : res;
+  p->fileIsOpen = False;
+  return MemExtract_End(p, fileIndex, res);
+}
+
+/* passing the file from the solid block buffer of the archive handle */
+static SRes MemExtract_FromBuffer(CMemExtract *p, UInt32 fileIndex)
+{
+  C7zArchive *archive = p->archive;
+  size_t offset = 0, outSizeProcessed = 0;
+  Bool skip;
+  SRes res = SzArEx_Extract(&archive->db, archive->archiveStream.s, fileIndex,
+      &archive->blockIndex, &archive->outBuffer, &archive->outBufferSize,
+      &offset, &outSizeProcessed,
+      &archive->allocCache.s, &archive->allocCache.s);
+  if (res != SZ_OK)
+  {
+    archive->blockIndex = 0xFFFFFFFF;
+    return res;
+  }
+  RINOK(MemExtract_Begin(p, fileIndex, &skip));
+  if (skip)
+    return SZ_OK;
+  if (outSizeProcessed != 0)
+  {
+    p->res = p->callback->Data(p->callback->ctx, fileIndex, archive->outBuffer + offset, outSizeProcessed);
+    RINOK(p->res);
+  }
+  return MemExtract_End(p, fileIndex, SZ_OK);
+}
+
+/* Extract 'numFiles' files 'fileIndexes' (all files, if 'fileIndexes==NULL') of opened
+  archive to the callbacks. Each solid block is decoded one time and only up to its last
+  requested file, the data is passed in chunks of decoding window, so the memory usage
+  doesn't depend on the sizes of files */
+SRes Extract7zFilesToMem(C7zArchive *p, const unsigned *fileIndexes, unsigned numFiles, const C7zMemCallback *callback) {
+  CMemExtract extract;
+  UInt32 *indexes;
+  UInt32 num = 0, i;
+  SRes res = SZ_OK;
+
+  if (fileIndexes == NULL)
+    numFiles = p->db.db.NumFiles;
+  if (numFiles == 0)
+    return SZ_OK;
+  for (i = 0; fileIndexes != NULL && i < numFiles; i++)
+    if (fileIndexes[i] >= p->db.db.NumFiles)
+      return SZ_ERROR_PARAM;
+  /* the names of C7zFileInfo are UTF-8 on all systems */
+  RINOK(Archive_Load(p, SZ_AR_LOAD_UTF8_NAMES | SZ_AR_LOAD_ATTRIB));
+  indexes = (UInt32 *)SzAlloc(NULL, numFiles * sizeof(indexes[0]));
+  if (indexes == 0)
+    return SZ_ERROR_MEM;
+  for (i = 0; i < numFiles; i++)
+    indexes[i] = (fileIndexes != NULL) ? fileIndexes[i] : i;
+  if (fileIndexes != NULL)
+    qsort(indexes, numFiles, sizeof(indexes[0]), CompareFileIndexes);
+
+  extract.s.GetStream = MemExtract_GetStream;
+  extract.s.SetResult = MemExtract_SetResult;
+  extract.outStream.s.Write = MemExtract_Write;
+  extract.outStream.extract = &extract;
+  extract.archive = p;
+  extract.callback = callback;
+  extract.fileIsOpen = False;
+  extract.res = SZ_OK;
+
+  /* directories and empty files go first, they have no data in solid blocks */
+  for (i = 0; i < numFiles && res == SZ_OK; i++)
+  {
+    Bool skip;
+    if (i != 0 && indexes[i - 1] == indexes[i])
+      continue;
+    if (p->db.db.Files[indexes[i]].HasStream)
+    {
+      indexes[num++] = indexes[i];
+      continue;
+    }
+    res = MemExtract_Begin(&extract, indexes[i], &skip);
+    if (res == SZ_OK && !skip)
+      res = MemExtract_End(&extract, indexes[i], SZ_OK);
+  }
+
+  for (i = 0; i < num && res == SZ_OK;)
+  {
+    UInt32 folderIndex = p->db.FileIndexToFolderIndexMap[indexes[i]];
+    UInt32 last;
+    /* the file that is in the cache already */
+    if (Archive_IsFileCached(p, indexes[i]))
+    {
+      res = MemExtract_FromBuffer(&extract, indexes[i]);
+      i++;
+      continue;
+    }
+    for (last = i + 1; last < num && p->db.FileIndexToFolderIndexMap[indexes[last]] == folderIndex; last++);
+    extract.fileIndexes = indexes + i;
+    extract.numFiles = last - i;
+    extract.pos = 0;
+    extract.res = SZ_OK;
+    ArchiveInStream_PrefetchFolder(&p->archiveStream, &p->db, folderIndex);
+    res = SzArEx_ExtractFolderPart(&p->db, p->archiveStream.s, folderIndex,
+        indexes[last - 1], &extract.s, &p->allocCache.s);
+    /* the error of the caller's callback stops the decoder with SZ_ERROR_WRITE */
+    if (res != SZ_OK && extract.res != SZ_OK)
+      res = extract.res;
+    i = last;
+  }
+  SzFree(NULL, indexes);
+  return res;
+}
+
+/* Size of file 'fileIndex' of opened archive */
+unsigned long long Get7zFileSize(C7zArchive *p, unsigned fileIndex) {
+  return (fileIndex < p->db.db.NumFiles) ? p->db.db.Files[fileIndex].Size : 0;
+}
+
+typedef struct
+{
+  Byte *buf;
+  size_t size;
+  size_t pos;
+} CBufExtract;
+
+static int BufExtract_Begin(void *ctx, const C7zFileInfo *info, int *skip)
+{
+  ctx = ctx; info = info; skip = skip;
+  return SZ_OK;
+}
+
+static int BufExtract_Data(void *ctx, unsigned fileIndex, const void *data, size_t size)
+{
+  CBufExtract *p = (CBufExtract *)ctx;
+  fileIndex = fileIndex;
+  if (size > p->size - p->pos)
+    return SZ_ERROR_OUTPUT_EOF;
+  memcpy(p->buf + p->pos, data, size);
+  p->pos += size;
+  return SZ_OK;
+}
+
+static int BufExtract_End(void *ctx, unsigned fileIndex, int res)
+{
+  ctx = ctx; fileIndex = fileIndex;
+  return res;
+}
+
+/* Extract file 'fileIndex' of opened archive to the buffer 'buf' of 'bufSize' bytes,
+  '*size' - the size of file. Returns SZ_ERROR_OUTPUT_EOF, if the buffer is too small */
+SRes Extract7zFileToBuf(C7zArchive *p, unsigned fileIndex, void *buf, size_t bufSize, size_t *size) {
+  UInt32 folderIndex;
+  UInt64 fileSize;
+  *size = 0;
+  if (fileIndex >= p->db.db.NumFiles)
+    return SZ_ERROR_PARAM;
+  fileSize = p->db.db.Files[fileIndex].Size;
+  if (fileSize > bufSize)
+  {
+    *size = (fileSize == (size_t)fileSize) ? (size_t)fileSize : (size_t)-1;
+    return SZ_ERROR_OUTPUT_EOF;
+  }
+  *size = (size_t)fileSize;
+  if (fileSize == 0)
+    return SZ_OK;
+  folderIndex = p->db.FileIndexToFolderIndexMap[fileIndex];
+  /* the only file of solid block is decoded directly to the buffer */
+  if (p->db.db.Folders[folderIndex].NumUnpackStreams == 1 && !Archive_IsFileCached(p, fileIndex))
+  {
+    ArchiveInStream_PrefetchFolder(&p->archiveStream, &p->db, folderIndex);
+    return DecodeSingleFileFolder(&p->db, p->archiveStream.s, folderIndex,
+        (Byte *)buf, (size_t)fileSize, &p->allocCache.s);
+  }
+  {
+    CBufExtract extract;
+    C7zMemCallback callback;
+    extract.buf = (Byte *)buf;
+    extract.size = bufSize;
+    extract.pos = 0;
+    callback.ctx = &extract;
+    callback.Begin = BufExtract_Begin;
+    callback.Data = BufExtract_Data;
+    callback.End = BufExtract_End;
+    return Extract7zFilesToMem(p, &fileIndex, 1, &callback);
+  }
+}
+
+
+/* Entries of all files of opened archive, the array is valid until Close7zArchive.
+  It's made from the header at the first call: the names point to the table of UTF-8 names */
+SRes Get7zListEntries(C7zArchive *p, const C7zListEntry **entries, unsigned *numEntries) {
+  const CSzArEx *db = &p->db;
+  if (p->listEntries == NULL && db->db.NumFiles != 0)
+  {
+    UInt32 i;
+    C7zListEntry *e;
+    RINOK(Archive_Load(p, SZ_AR_LOAD_UTF8_NAMES | SZ_AR_LOAD_MTIME | SZ_AR_LOAD_ATTRIB));
+    e = (C7zListEntry *)SzAlloc(NULL, db->db.NumFiles * sizeof(C7zListEntry));
+    if (e == 0)
+      return SZ_ERROR_MEM;
+    p->listEntries = e;
+    for (i = 0; i < db->db.NumFiles; i++, e++)
+    {
+      const CSzFileItem *f = db->db.Files + i;
+      e->name = SzArEx_GetFileNameUtf8(db, i, &e->nameLen);
+      e->size = f->Size;
+      e->mtime = ((UInt64)f->MTime.High << 32) | f->MTime.Low;
+      e->folder = db->FileIndexToFolderIndexMap[i];
+      if (!f->HasStream)
+        e->folder = (unsigned)-1;
+      e->crc = f->Crc;
+      e->attrib = f->Attrib;
+      e->crcDefined = f->CrcDefined;
+      e->mtimeDefined = f->MTimeDefined;
+      e->attribDefined = f->AttribDefined;
+      e->isDir = f->IsDir;
+    }
+  }
+  *entries = p->listEntries;
+  *numEntries = db->db.NumFiles;
+  return SZ_OK;
+}
+
+/* The listing is formatted to the buffer and it's written with one call for each
+  LIST_WRITER_BUF_SIZE bytes */
+#define LIST_WRITER_BUF_SIZE (1 << 16)
+
+typedef struct
+{
+  FILE *file;
+  size_t pos;
+  SRes res;
+  char buf[LIST_WRITER_BUF_SIZE];
+} CListWriter;
+
+static void ListWriter_Flush(CListWriter *p)
+{
+  if (p->pos != 0 && p->res == SZ_OK && fwrite(p->buf, 1, p->pos, p->file) != p->pos)
+    p->res = SZ_ERROR_WRITE;
+  p->pos = 0;
+}
+
+/* making room for 'size' bytes in the buffer */
+#define ListWriter_Reserve(p, size) { if ((p)->pos + (size) > LIST_WRITER_BUF_SIZE) ListWriter_Flush(p); }
+
+/* ASCII string 's' (not longer than 64 bytes) */
+static void ListWriter_PutString(CListWriter *p, const char *s)
+{
+  ListWriter_Reserve(p, 64);
+  for (; *s != 0; s++)
+    p->buf[p->pos++] = *s;
+}
+
+static void ListWriter_PutUInt64(CListWriter *p, UInt64 v)
+{
+  char temp[20];
+  unsigned i = 0;
+  ListWriter_Reserve(p, 20);
+  do
+  {
+    temp[i++] = (char)('0' + (unsigned)(v % 10));
+    v /= 10;
+  }
+  while (v != 0);
+  do
+    p->buf[p->pos++] = temp[--i];
+  while (i != 0);
+}
+
+static const char kListHexDigits[16] =
+  { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+/* 'numDigits' low hex digits of 'v' */
+static void ListWriter_PutHex(CListWriter *p, UInt32 v, unsigned numDigits)
+{
+  ListWriter_Reserve(p, 8);
+  while (numDigits != 0)
+    p->buf[p->pos++] = kListHexDigits[(v >> (--numDigits * 4)) & 0xF];
+}
+
+/* the name with escapes: TSV - '\\', '\t', '\n', '\r' and '\xHH' for other control characters,
+  JSON - the string in quotes */
+static void ListWriter_PutName(CListWriter *p, const char *name, size_t len, int format)
+{
+  size_t i;
+  if (format == LIST7Z_FORMAT_JSON)
+    ListWriter_PutString(p, "\"");
+  for (i = 0; i < len; i++)
+  {
+    Byte c = (Byte)name[i];
+    ListWriter_Reserve(p, 6);
+    if (c >= 0x20 && c != '\\' && (c != '"' || format != LIST7Z_FORMAT_JSON))
+    {
+      p->buf[p->pos++] = (char)c;
+      continue;
+    }
+    p->buf[p->pos++] = '\\';
+    switch (c)
+    {
+      case '\t': p->buf[p->pos++] = 't'; break;
+      case '\n': p->buf[p->pos++] = 'n'; break;
+      case '\r': p->buf[p->pos++] = 'r'; break;
+      case '\\':
+      case '"': p->buf[p->pos++] = (char)c; break;
+      default:
+        ListWriter_PutString(p, (format == LIST7Z_FORMAT_JSON) ? "u00" : "x");
+        ListWriter_PutHex(p, c, 2);
+    }
+  }
+  if (format == LIST7Z_FORMAT_JSON)
+    ListWriter_PutString(p, "\"");
+}
+
+/* TSV line: name, size, folder, crc, mtime, attrib, isDir; undefined fields are empty */
+static void ListWriter_PutTsv(CListWriter *p, const C7zListEntry *e)
+{
+  ListWriter_PutName(p, e->name, e->nameLen, LIST7Z_FORMAT_TSV);
+  ListWriter_PutString(p, "\t");
+  ListWriter_PutUInt64(p, e->size);
+  ListWriter_PutString(p, "\t");
+  if (e->folder != (unsigned)-1)
+    ListWriter_PutUInt64(p, e->folder);
+  ListWriter_PutString(p, "\t");
+  if (e->crcDefined)
+    ListWriter_PutHex(p, e->crc, 8);
+  ListWriter_PutString(p, "\t");
+  if (e->mtimeDefined)
+    ListWriter_PutUInt64(p, e->mtime);
+  ListWriter_PutString(p, "\t");
+  if (e->attribDefined)
+    ListWriter_PutUInt64(p, e->attrib);
+  ListWriter_PutString(p, e->isDir ? "\t1\n" : "\t0\n");
+}
+
+/* JSON line: the object with the same fields, undefined fields are null */
+static void ListWriter_PutJson(CListWriter *p, const C7zListEntry *e)
+{
+  ListWriter_PutString(p, "{\"name\":");
+  ListWriter_PutName(p, e->name, e->nameLen, LIST7Z_FORMAT_JSON);
+  ListWriter_PutString(p, ",\"size\":");
+  ListWriter_PutUInt64(p, e->size);
+  ListWriter_PutString(p, ",\"folder\":");
+  if (e->folder != (unsigned)-1)
+    ListWriter_PutUInt64(p, e->folder);
+  else
+    ListWriter_PutString(p, "null");
+  ListWriter_PutString(p, ",\"crc\":");
+  if (e->crcDefined)
+  {
+    ListWriter_PutString(p, "\"");
+    ListWriter_PutHex(p, e->crc, 8);
+    ListWriter_PutString(p, "\"");
+  }
+  else
+    ListWriter_PutString(p, "null");
+  ListWriter_PutString(p, ",\"mtime\":");
+  if (e->mtimeDefined)
+    ListWriter_PutUInt64(p, e->mtime);
+  else
+    ListWriter_PutString(p, "null");
+  ListWriter_PutString(p, ",\"attrib\":");
+  if (e->attribDefined)
+    ListWriter_PutUInt64(p, e->attrib);
+  else
+    ListWriter_PutString(p, "null");
+  ListWriter_PutString(p, e->isDir ? ",\"isDir\":true}\n" : ",\"isDir\":false}\n");
+}
+
+/* Write entries of opened archive to 'outFile' (stdout, if 'outFile==NULL') in 'format':
+  LIST7Z_FORMAT_TSV - the line of field names and the line of each file,
+  LIST7Z_FORMAT_JSON - JSON object in each line */
+SRes Write7zList(C7zArchive *p, const char *outFile, int format) {
+  const C7zListEntry *entries;
+  unsigned numEntries, i;
+  CListWriter *writer;
+  SRes res;
+  if (format != LIST7Z_FORMAT_TSV && format != LIST7Z_FORMAT_JSON)
+    return SZ_ERROR_PARAM;
+  RINOK(Get7zListEntries(p, &entries, &numEntries));
+  writer = (CListWriter *)SzAlloc(NULL, sizeof(CListWriter));
+  if (writer == 0)
+    return SZ_ERROR_MEM;
+  writer->file = stdout;
+  if (outFile != NULL && (writer->file = fopen(outFile, "wb")) == NULL)
+  {
+    printf("\nERROR: can not open output file");
+    SzFree(NULL, writer);
+    return SZ_ERROR_FAIL;
+  }
+  writer->pos = 0;
+  writer->res = SZ_OK;
+  if (format == LIST7Z_FORMAT_TSV)
+    ListWriter_PutString(writer, "name\tsize\tfolder\tcrc\tmtime\tattrib\tisDir\n");
+  for (i = 0; i < numEntries && writer->res == SZ_OK; i++)
+  {
+    if (format == LIST7Z_FORMAT_TSV)
+      ListWriter_PutTsv(writer, entries + i);
+    else
+      ListWriter_PutJson(writer, entries + i);
+  }
+  ListWriter_Flush(writer);
+  res = writer->res;
+  if (outFile != NULL)
+  {
+    if (fclose(writer->file) != 0 && res == SZ_OK)
+      res = SZ_ERROR_WRITE;
+  }
+  else if (fflush(stdout) != 0 && res == SZ_OK)
+    res = SZ_ERROR_WRITE;
+  SzFree(NULL, writer);
+  return res;
+}
+
+/* Write entries of 'archiveFile' to 'outFile' (stdout, if 'outFile==NULL') in 'format',
+  only the header of archive is read */
+SRes List7zFilesFormat(char* archiveFile, const char *outFile, int format) {
+  C7zArchive *archive;
+  SRes res = Open7zArchive(archiveFile, &archive);
+  if (res != SZ_OK)
+    return res;
+  res = Write7zList(archive, outFile, format);
+  Close7zArchive(archive);
+  return res;
+}
+
+/* Extract 'fileName' from archive */
+static SRes Decode7zOneFileSource(const CArchiveSource *src, char* fileName) {
+  C7zArchive *archive;
+  const UInt16 *name;
+  SRes res;
+  size_t len;
+  UInt32 i;
+
+  /* opening archive & filling 'db' structure */
+  res = Open7zSource(src, &archive);
+  if (res != SZ_OK)
+    return res;
+  if (Char_To_Utf16(&archive->nameBuf, fileName, &len) != 0)
+  {
+    /* there can't be such file in archive */
+    Close7zArchive(archive);
+    return SZ_OK;
+  }
+  res = Archive_Load(archive, SZ_AR_LOAD_NAME_HASH);
+  if (res != SZ_OK)
+  {
+    Close7zArchive(archive);
+    return res;
+  }
+  name = (const UInt16 *)archive->nameBuf.data;
+  /* running through the files with that name without sub-directories */
+  for (i = SzArEx_FindFile(&archive->db, name, len, 1, 0); i != (UInt32)-1;
+      i = SzArEx_FindFile(&archive->db, name, len, 1, i + 1))
+  {
+    /* skipping directories */
+    if (archive->db.db.Files[i].IsDir)
+      continue;
+    res = Extract7zFile(archive, i, 0);
+    if (res != SZ_OK)
+      break;
+  }
+  Close7zArchive(archive);
+  return res;
+}
+
+/* Ðàñïàêîâàòü ôàéë fileName èç àðõèâà archiveFile */
+SRes Decode7zOneFile(char* archiveFile, char* fileName) {
+  CArchiveSource src;
+  src.name = archiveFile;
+  return Decode7zOneFileSource(&src, fileName);
+}
+
+/* Extract 'fileName' from archive 'data' of 'size' bytes in memory */
+SRes Decode7zOneFileMem(const void *data, size_t size, char* fileName) {
+  CArchiveSource src;
+  src.name = NULL;
+  src.data = data;
+  src.size = size;
+  return Decode7zOneFileSource(&src, fileName);
+}
+
+
+/* Shared state of the parallel extraction: workers take whole solid blocks one by one */
+typedef struct
+{
+  const CArchiveSource *src;
+  const CSzArEx *db;
+  int fullPaths;
+  UInt32 nextFolder;
+  SRes res;
+  CCriticalSection cs;
+} CExtractMt;
+
+/* getting index of the next solid block to extract, NumFolders - if there is no more work */
+static UInt32 ExtractMt_GetFolder(CExtractMt *p, SRes res)
+{
+  UInt32 folderIndex = p->db->db.NumFolders;
+  CriticalSection_Enter(&p->cs);
+  if (p->res == SZ_OK)
+    p->res = res;
+  if (p->res == SZ_OK && p->nextFolder < p->db->db.NumFolders)
+    folderIndex = p->nextFolder++;
+  CriticalSection_Leave(&p->cs);
+  return folderIndex;
+}
+
+/* extracting solid blocks through the archive stream of the current thread */
+static void ExtractMt_Extract(CExtractMt *p, CArchiveInStream *inStream)
+{
+  CExtractCallback extractCallback;
+  /* the decoders of each thread are reused for its solid blocks */
+  CAllocCache allocCache;
+  SRes res = SZ_OK;
+
+  AllocCache_Init(&allocCache);
+  ExtractCallback_Init(&extractCallback, p->db, p->fullPaths);
+  /* the directories were created before the threads were started */
+  extractCallback.dirsCreated = True;
+  for (;;)
+  {
+    UInt32 folderIndex = ExtractMt_GetFolder(p, res);
+    Bool mapped;
+    if (folderIndex >= p->db->db.NumFolders)
+      break;
+    /* skipping solid blocks without files */
+    if (p->db->db.Folders[folderIndex].NumUnpackStreams == 0)
+      continue;
+    ArchiveInStream_PrefetchFolder(inStream, p->db, folderIndex);
+    mapped = False;
+    if (ExtractCallback_CanMap(p->db, folderIndex))
+      res = ExtractCallback_ExtractMapped(&extractCallback, inStream->s, folderIndex, &allocCache.s, &mapped);
+    if (!mapped && res == SZ_OK)
+      res = SzArEx_ExtractFolder(p->db, inStream->s, folderIndex,
+          &extractCallback.s, &allocCache.s);
+    if (res == SZ_ERROR_WRITE)
+    {
+      printf("\nERROR: can not write output file");
+      res = SZ_ERROR_FAIL;
+    }
+  }
+  AllocCache_FreeAll(&allocCache);
+  ExtractCallback_Free(&extractCallback);
+}
+
+/* worker thread: opening its own archive stream, so solid blocks are read independently */
+static THREAD_FUNC_DECL ExtractMt_ThreadFunc(void *pp)
+{
+  CExtractMt *p = (CExtractMt *)pp;
+  CArchiveInStream archiveStream;
+
+  if (ArchiveInStream_Open(&archiveStream, p->src))
+  {
+    printf("\nERROR: can not open input file");
+    ExtractMt_GetFolder(p, SZ_ERROR_FAIL);
+    return 0;
+  }
+
+  ExtractMt_Extract(p, &archiveStream);
+
+  ArchiveInStream_Close(&archiveStream);
+  return 0;
+}
+
+/* Extract archive with 'numThreads' threads, which decode
+  different solid blocks at the same time.
+  if used with 'fullPaths==1' - it will keep directories structure */
+static SRes Decode7zSourceMt(const CArchiveSource *src, int fullPaths, int numThreads) {
+  CArchiveInStream archiveStream;
+  CSzArEx db;
+  SRes res;
+  CAllocArena arena;
+
+  AllocArena_Init(&arena);
+
+  /* opening archive file */
+  if (ArchiveInStream_Open(&archiveStream, src))
+  {
+    printf("\nERROR: can not open input file");
+    return SZ_ERROR_FAIL;
+  }
+
+
+  /* opening archive & filling 'db' structure */
+  res = OpenArchiveDb(&db, archiveStream.s, OPEN_FLAGS_FS_NAMES, &arena, NULL);
+  if (res == SZ_OK)
+  {
+    CExtractCallback extractCallback;
+    UInt32 i;
+
+    /* directories and empty files are created before the decoding */
+    ExtractCallback_Init(&extractCallback, &db, fullPaths);
+    res = ExtractCallback_CreateDirs(&extractCallback);
+    for (i = 0; i < db.db.NumFiles && res == SZ_OK; i++)
+    {
+      const CSzFileItem *f = db.db.Files + i;
+      if (f->HasStream || (f->IsDir && !fullPaths))
+        continue;
+      res = ExtractCallback_ExtractEmptyItem(&extractCallback, i);
+      if (res != SZ_OK)
+        break;
+    }
+    ExtractCallback_Free(&extractCallback);
+  }
+  if (res == SZ_OK)
+  {
+    CExtractMt mt;
+    CThread *threads = NULL;
+    int t, numCreated = 0;
+
+    mt.src = src;
+    mt.db = &db;
+    mt.fullPaths = fullPaths;
+    mt.nextFolder = 0;
+    mt.res = SZ_OK;
+
+    /* there is no sense in threads without solid blocks for them */
+    if (numThreads < 1)
+      numThreads = 1;
+    if ((UInt32)numThreads > db.db.NumFolders)
+      numThreads = (int)db.db.NumFolders;
+    if (numThreads > 1)
+    {
+      threads = (CThread *)SzAlloc(NULL, (numThreads - 1) * sizeof(threads[0]));
+      if (threads == 0)
+        numThreads = 1;
+    }
+    if (CriticalSection_Init(&mt.cs) != 0)
+      res = SZ_ERROR_THREAD;
+    else
+    {
+      /* the current thread is a worker too */
+      for (t = 0; t < numThreads - 1; t++)
+      {
+        Thread_Construct(&threads[t]);
+        if (Thread_Create(&threads[t], ExtractMt_ThreadFunc, &mt) != 0)
+          break;
+        numCreated++;
+      }
+      ExtractMt_Extract(&mt, &archiveStream);
+      for (t = 0; t < numCreated; t++)
+      {
+        Thread_Wait(&threads[t]);
+        Thread_Close(&threads[t]);
+      }
+      CriticalSection_Delete(&mt.cs);
+      res = mt.res;
+    }
+    SzFree(NULL, threads);
+  }
+  SzArEx_Free(&db, &arena.s);
+  AllocArena_FreeAll(&arena);
+  /* closing file archive */
+  ArchiveInStream_Close(&archiveStream);
+  return res;
+}
+
+/* Extract archive 'archiveFile' with 'numThreads' threads, which decode
+  different solid blocks at the same time.
+  if used with 'fullPaths==1' - it will keep directories structure */
+SRes Decode7zFilesMt(char* archiveFile, int fullPaths, int numThreads) {
+  CArchiveSource src;
+  src.name = archiveFile;
+  return Decode7zSourceMt(&src, fullPaths, numThreads);
+}
+
+/* Same as Decode7zFilesMt for archive 'data' of 'size' bytes in memory */
+SRes Decode7zFilesMtMem(const void *data, size_t size, int fullPaths, int numThreads) {
+  CArchiveSource src;
+  src.name = NULL;
+  src.data = data;
+  src.size = size;
+  return Decode7zSourceMt(&src, fullPaths, numThreads);
+}
+
+/* Read the archive through buffer of 'bufSize' bytes instead of mapping it to memory,
+  'adaptive==1' - the reads start with 16 KB after each seek and grow 2 times with
+  each next read up to 'bufSize'. 0 (default) - the archive is mapped to memory */
+void Set7zInBufSize(unsigned bufSize, int adaptive) {
+  g_InBufSize = bufSize;
+  g_InBufAdaptive = (Bool)(adaptive != 0);
+}
+
+/* Read the archive by separate thread with reads of 'bufSize' bytes (rounded up to 4 KB),
+  while the decoder uses the data read before, instead of mapping the archive to memory.
+  0 (default) - the archive is mapped to memory */
+void Set7zReadAhead(unsigned bufSize) {
+  g_ReadAheadSize = ((size_t)bufSize + (1 << 12) - 1) & ~(size_t)((1 << 12) - 1);
+}
+
+/* Write the files in Decode7zFiles by separate thread, while next data is decoded,
+  'maxQueuedSize' - the maximum size of decoded data waiting for writing,
+  0 (default) - the files are written by decoding thread */
+void Set7zWriteBehind(unsigned maxQueuedSize) {
+  g_WriteBehindSize = maxQueuedSize;
+}
+
+/* Keep the index files of archives opened by Open7zArchive in the directory 'dir',
+  so the next opens of the same archives don't read and parse their headers.
+  'dir' must exist, and the string must stay valid. NULL (default) - no index cache */
+void Set7zIndexCache(const char *dir) {
+  g_IndexCacheDir = dir;
+}
+
+/* Decode the files, that are the only ones in their solid blocks (in non-solid
+  archives), directly to the memory-mapped output files, 'enable==0' by default */
+void Set7zMapOutFiles(int enable) {
+  g_MapOutFiles = enable;
+}
+
+/* Set number of threads, which are used for decoding of one LZMA2 stream with
+  dictionary resets (such streams are written by multithreaded compressors).
+  It takes effect, when solid block is decoded to memory (Decode7zOneFile, Extract7zFile) */
+void Set7zNumThreads(int numThreads) {
+  SzDec_SetNumThreads(numThreads > 0 ? (UInt32)numThreads : 1);
+}
@@ -0,0 +1,231 @@
+/* Lzma2DecMt.c -- LZMA2 Decoder (multithreaded)
+Public domain */
+
+#include "Lzma2DecMt.h"
+#include "Threads.h"
+
+/* see the description of LZMA2 chunks in Lzma2Dec.c */
+
+#define LZMA2_CONTROL_LZMA (1 << 7)
+#define LZMA2_CONTROL_COPY_RESET_DIC 1
+#define LZMA2_CONTROL_EOF 0
+
+#define LZMA2_IS_THERE_PROP(control) ((((control) >> 5) & 3) >= 2)
+#define LZMA2_IS_RESET_DIC(control) ((control) == LZMA2_CONTROL_COPY_RESET_DIC || (control) >= 0xE0)
+
+typedef struct
+{
+  SizeT srcPos;
+  SizeT srcSize;
+  SizeT destPos;
+  SizeT destSize;
+} CLzma2DecMtBlock;
+
+/*
+Lzma2DecMt_Parse splits the stream to blocks, each of them starts with the chunk
+that resets the dictionary. If (blocks == NULL), it only counts blocks.
+Returns the number of blocks or 0, if sizes in chunk headers don't match
+(srcLen) and (destLen). The stream is decoded as one block in that case,
+and the decoder reports the error.
+*/
+
+static UInt32 Lzma2DecMt_Parse(const Byte *src, SizeT srcLen, SizeT destLen, CLzma2DecMtBlock *blocks)
+{
+  SizeT pos = 0, destPos = 0;
+  UInt32 numBlocks = 0;
+  for (;;)
+  {
+    unsigned control;
+    SizeT headerSize, unpackSize, packSize;
+    if (pos == srcLen)
+      return 0;
+    control = src[pos];
+    if (control == LZMA2_CONTROL_EOF)
+      break;
+    if (control & LZMA2_CONTROL_LZMA)
+      headerSize = LZMA2_IS_THERE_PROP(control) ? 6 : 5;
+    else if (control <= 2)
+      headerSize = 3;
+    else
+      return 0;
+    if (srcLen - pos < headerSize)
+      return 0;
+    unpackSize = ((SizeT)src[pos + 1] << 8) + src[pos + 2] + 1;
+    packSize = unpackSize;
+    if (control & LZMA2_CONTROL_LZMA)
+    {
+      unpackSize += (SizeT)(control & 0x1F) << 16;
+      packSize = ((SizeT)src[pos + 3] << 8) + src[pos + 4] + 1;
+    }
+    if (LZMA2_IS_RESET_DIC(control))
+    {
+      if (blocks)
+      {
+        if (numBlocks != 0)
+        {
+          blocks[numBlocks - 1].srcSize = pos - blocks[numBlocks - 1].srcPos;
+          blocks[numBlocks - 1].destSize = destPos - blocks[numBlocks - 1].destPos;
+        }
+        blocks[numBlocks].srcPos = pos;
+        blocks[numBlocks].destPos = destPos;
+      }
+      numBlocks++;
+    }
+    else if (numBlocks == 0)
+      return 0;
+    if (srcLen - pos - headerSize < packSize || destLen - destPos < unpackSize)
+      return 0;
+    pos += headerSize + packSize;
+    destPos += unpackSize;
+  }
+  if (pos + 1 != srcLen || destPos != destLen || numBlocks == 0)
+    return 0;
+  if (blocks)
+  {
+    blocks[numBlocks - 1].srcSize = srcLen - blocks[numBlocks - 1].srcPos;
+    blocks[numBlocks - 1].destSize = destLen - blocks[numBlocks - 1].destPos;
+  }
+  return numBlocks;
+}
+
+static SRes Lzma2DecMt_DecodeBlock(CLzma2Dec *dec, Byte *dest, const Byte *src,
+    const CLzma2DecMtBlock *block, Bool isLast)
+{
+  SizeT srcLen = block->srcSize;
+  ELzmaStatus status;
+  dec->decoder.dic = dest + block->destPos;
+  dec->decoder.dicBufSize = block->destSize;
+  Lzma2Dec_Init(dec);
+  RINOK(Lzma2Dec_DecodeToDic(dec, block->destSize, src + block->srcPos, &srcLen, LZMA_FINISH_END, &status));
+  /* the block that is not last must end exactly before the next chunk header */
+  if (srcLen != block->srcSize || dec->decoder.dicPos != block->destSize ||
+      status != (isLast ? LZMA_STATUS_FINISHED_WITH_MARK : LZMA_STATUS_NEEDS_MORE_INPUT))
+    return SZ_ERROR_DATA;
+  return SZ_OK;
+}
+
+typedef struct
+{
+  Byte *dest;
+  const Byte *src;
+  const CLzma2DecMtBlock *blocks;
+  UInt32 numBlocks;
+  UInt32 nextBlock;
+  Byte prop;
+  ISzAlloc *alloc;
+  SRes res;
+  CCriticalSection cs;
+} CLzma2DecMt;
+
+/* returns index of the next block to decode, or numBlocks, if there is no more work */
+static UInt32 Lzma2DecMt_GetBlock(CLzma2DecMt *p, SRes res)
+{
+  UInt32 blockIndex = p->numBlocks;
+  CriticalSection_Enter(&p->cs);
+  if (p->res == SZ_OK)
+    p->res = res;
+  if (p->res == SZ_OK && p->nextBlock < p->numBlocks)
+    blockIndex = p->nextBlock++;
+  CriticalSection_Leave(&p->cs);
+  return blockIndex;
+}
+
+static void Lzma2DecMt_DecodeBlocks(CLzma2DecMt *p)
+{
+  CLzma2Dec dec;
+  SRes res;
+  Lzma2Dec_Construct(&dec);
+  /* (alloc) can be not thread-safe, so the threads call it one at a time */
+  CriticalSection_Enter(&p->cs);
+  res = Lzma2Dec_AllocateProbs(&dec, p->prop, p->alloc);
+  CriticalSection_Leave(&p->cs);
+  for (;;)
+  {
+    UInt32 blockIndex = Lzma2DecMt_GetBlock(p, res);
+    if (blockIndex >= p->numBlocks)
+      break;
+    res = Lzma2DecMt_DecodeBlock(&dec, p->dest, p->src, &p->blocks[blockIndex],
+        (Bool)(blockIndex == p->numBlocks - 1));
+  }
+  CriticalSection_Enter(&p->cs);
+  Lzma2Dec_FreeProbs(&dec, p->alloc);
+  CriticalSection_Leave(&p->cs);
+}
+
+static THREAD_FUNC_DECL Lzma2DecMt_ThreadFunc(void *p)
+{
+  Lzma2DecMt_DecodeBlocks((CLzma2DecMt *)p);
+  return 0;
+}
+
+SRes Lzma2DecMt_Decode(Byte *dest, SizeT destLen, const Byte *src, SizeT srcLen,
+    Byte prop, UInt32 numThreads, ISzAlloc *alloc)
+{
+  CLzma2DecMt p;
+  CLzma2DecMtBlock block;
+  CLzma2DecMtBlock *blocks = NULL;
+  CThread *threads = NULL;
+  UInt32 numBlocks = 0, numCreated = 0, t;
+
+  p.dest = dest;
+  p.src = src;
+  p.nextBlock = 0;
+  p.prop = prop;
+  p.alloc = alloc;
+  p.res = SZ_OK;
+
+  if (numThreads > 1)
+    numBlocks = Lzma2DecMt_Parse(src, srcLen, destLen, NULL);
+  if (numBlocks > 1)
+  {
+    blocks = (CLzma2DecMtBlock *)alloc->Alloc(alloc, numBlocks * sizeof(blocks[0]));
+    if (blocks == 0)
+      return SZ_ERROR_MEM;
+    Lzma2DecMt_Parse(src, srcLen, destLen, blocks);
+    if (numThreads > numBlocks)
+      numThreads = numBlocks;
+    threads = (CThread *)alloc->Alloc(alloc, (numThreads - 1) * sizeof(threads[0]));
+    if (threads == 0)
+      numThreads = 1;
+  }
+  else
+  {
+    /* there is nothing to decode in parallel */
+    block.srcPos = block.destPos = 0;
+    block.srcSize = srcLen;
+    block.destSize = destLen;
+    blocks = &block;
+    numBlocks = 1;
+    numThreads = 1;
+  }
+  p.blocks = blocks;
+  p.numBlocks = numBlocks;
+
+  if (CriticalSection_Init(&p.cs) != 0)
+    p.res = SZ_ERROR_THREAD;
+  else
+  {
+    /* the current thread decodes blocks too */
+    for (t = 0; t < numThreads - 1; t++)
+    {
+      Thread_Construct(&threads[t]);
+      if (Thread_Create(&threads[t], Lzma2DecMt_ThreadFunc, &p) != 0)
+        break;
+      numCreated++;
+    }
+    Lzma2DecMt_DecodeBlocks(&p);
+    for (t = 0; t < numCreated; t++)
+    {
+      Thread_Wait(&threads[t]);
+      Thread_Close(&threads[t]);
+    }
+    CriticalSection_Delete(&p.cs);
+  }
+
+  if (blocks != &block)
+  {
+    alloc->Free(alloc, threads);
+    alloc->Free(alloc, blocks);
+  }
+  return p.res;
+}
@@ -0,0 +1,41 @@
+/* Lzma2DecMt.h -- LZMA2 Decoder (multithreaded)
+Public domain */
+
+#ifndef __LZMA2_DEC_MT_H
+#define __LZMA2_DEC_MT_H
+
+#include "Lzma2Dec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+LZMA2 stream can contain several chunks that reset the dictionary
+(multithreaded encoders write such a chunk at the start of each block).
+Data after such chunk doesn't depend on data before it, so these parts
+of stream are decoded by different threads directly to their places in (dest).
+
+Lzma2DecMt_Decode decodes whole LZMA2 stream from (src) to (dest).
+  (srcLen) must be exact size of stream including end marker,
+  (destLen) must be exact size of unpacked data.
+  numThreads - maximum number of threads (including current thread).
+  alloc - the threads call it one at a time, so it can be not thread-safe,
+    but it must not be used by other threads until Lzma2DecMt_Decode returns.
+
+Returns:
+  SZ_OK
+  SZ_ERROR_DATA - Data error
+  SZ_ERROR_MEM  - Memory allocation error
+  SZ_ERROR_UNSUPPORTED - Unsupported properties
+  SZ_ERROR_THREAD - Can not create synchronization object
+*/
+
+SRes Lzma2DecMt_Decode(Byte *dest, SizeT destLen, const Byte *src, SizeT srcLen,
+    Byte prop, UInt32 numThreads, ISzAlloc *alloc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+/* Threads.c -- multithreading library
+Public domain */
+
+#ifdef _WIN32
+#include <process.h>
+#endif
+
+#include "Threads.h"
+
+#ifdef _WIN32
+
+void Thread_Construct(CThread *p) { *p = NULL; }
+Bool Thread_WasCreated(const CThread *p) { return *p != NULL; }
+
+WRes Thread_Create(CThread *p, THREAD_FUNC_TYPE func, void *param)
+{
+  unsigned threadId;
+  *p = (HANDLE)_beginthreadex(NULL, 0, func, param, 0, &threadId);
+  return (*p != NULL) ? 0 : GetLastError();
+}
+
+WRes Thread_Wait(CThread *p)
+{
+  DWORD dw = WaitForSingleObject(*p, INFINITE);
+  return (dw == WAIT_OBJECT_0) ? 0 : GetLastError();
+}
+
+WRes Thread_Close(CThread *p)
+{
+  if (*p != NULL)
+  {
+    if (!CloseHandle(*p))
+      return GetLastError();
+    *p = NULL;
+  }
+  return 0;
+}
+
+WRes CriticalSection_Init(CCriticalSection *p)
+{
+  InitializeCriticalSection(p);
+  return 0;
+}
+
+void CriticalSection_Delete(CCriticalSection *p) { DeleteCriticalSection(p); }
+void CriticalSection_Enter(CCriticalSection *p) { EnterCriticalSection(p); }
+void CriticalSection_Leave(CCriticalSection *p) { LeaveCriticalSection(p); }
+
+void Event_Construct(CAutoResetEvent *p) { *p = NULL; }
+
+WRes AutoResetEvent_CreateNotSignaled(CAutoResetEvent *p)
+{
+  *p = CreateEvent(NULL, FALSE, FALSE, NULL);
+  return (*p != NULL) ? 0 : GetLastError();
+}
+
+WRes Event_Set(CAutoResetEvent *p) { return SetEvent(*p) ? 0 : GetLastError(); }
+
+WRes Event_Wait(CAutoResetEvent *p)
+{
+  DWORD dw = WaitForSingleObject(*p, INFINITE);
+  return (dw == WAIT_OBJECT_0) ? 0 : GetLastError();
+}
+
+WRes Event_Close(CAutoResetEvent *p)
+{
+  if (*p != NULL)
+  {
+    if (!CloseHandle(*p))
+      return GetLastError();
+    *p = NULL;
+  }
+  return 0;
+}
+
+#else
+
+void Thread_Construct(CThread *p) { p->created = 0; }
+Bool Thread_WasCreated(const CThread *p) { return p->created != 0; }
+
+WRes Thread_Create(CThread *p, THREAD_FUNC_TYPE func, void *param)
+{
+  WRes res = pthread_create(&p->thread, NULL, func, param);
+  p->created = (res == 0);
+  return res;
+}
+
+WRes Thread_Wait(CThread *p)
+{
+  if (!p->created)
+    return 0;
+  p->created = 0;
+  return pthread_join(p->thread, NULL);
+}
+
+WRes Thread_Close(CThread *p)
+{
+  if (p->created)
+  {
+    p->created = 0;
+    return pthread_detach(p->thread);
+  }
+  return 0;
+}
+
+WRes CriticalSection_Init(CCriticalSection *p) { return pthread_mutex_init(p, NULL); }
+void CriticalSection_Delete(CCriticalSection *p) { pthread_mutex_destroy(p); }
+void CriticalSection_Enter(CCriticalSection *p) { pthread_mutex_lock(p); }
+void CriticalSection_Leave(CCriticalSection *p) { pthread_mutex_unlock(p); }
+
+void Event_Construct(CAutoResetEvent *p) { p->created = 0; }
+
+WRes AutoResetEvent_CreateNotSignaled(CAutoResetEvent *p)
+{
+  WRes res = pthread_mutex_init(&p->mutex, NULL);
+  if (res != 0)
+    return res;
+  res = pthread_cond_init(&p->cond, NULL);
+  if (res != 0)
+  {
+    pthread_mutex_destroy(&p->mutex);
+    return res;
+  }
+  p->state = 0;
+  p->created = 1;
+  return 0;
+}
+
+WRes Event_Set(CAutoResetEvent *p)
+{
+  pthread_mutex_lock(&p->mutex);
+  p->state = 1;
+  pthread_mutex_unlock(&p->mutex);
+  return pthread_cond_signal(&p->cond);
+}
+
+WRes Event_Wait(CAutoResetEvent *p)
+{
+  pthread_mutex_lock(&p->mutex);
+  while (p->state == 0)
+    pthread_cond_wait(&p->cond, &p->mutex);
+  p->state = 0;
+  pthread_mutex_unlock(&p->mutex);
+  return 0;
+}
+
+WRes Event_Close(CAutoResetEvent *p)
+{
+  if (p->created)
+  {
+    p->created = 0;
+    pthread_cond_destroy(&p->cond);
+    return pthread_mutex_destroy(&p->mutex);
+  }
+  return 0;
+}
+
+#endif
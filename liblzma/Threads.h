@@ -0,0 +1,70 @@
+/* Threads.h -- multithreading library
+Public domain */
+
+#ifndef __7Z_THREADS_H
+#define __7Z_THREADS_H
+
+#include "Types.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+EXTERN_C_BEGIN
+
+#ifdef _WIN32
+
+typedef HANDLE CThread;
+typedef unsigned THREAD_FUNC_RET_TYPE;
+#define THREAD_FUNC_CALL_TYPE MY_STD_CALL
+
+typedef CRITICAL_SECTION CCriticalSection;
+
+typedef HANDLE CAutoResetEvent;
+
+#else
+
+typedef struct
+{
+  pthread_t thread;
+  int created;
+} CThread;
+typedef void * THREAD_FUNC_RET_TYPE;
+#define THREAD_FUNC_CALL_TYPE
+
+typedef pthread_mutex_t CCriticalSection;
+
+typedef struct
+{
+  int created;
+  int state;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} CAutoResetEvent;
+
+#endif
+
+#define THREAD_FUNC_DECL THREAD_FUNC_RET_TYPE THREAD_FUNC_CALL_TYPE
+typedef THREAD_FUNC_RET_TYPE (THREAD_FUNC_CALL_TYPE * THREAD_FUNC_TYPE)(void *);
+
+void Thread_Construct(CThread *p);
+Bool Thread_WasCreated(const CThread *p);
+WRes Thread_Create(CThread *p, THREAD_FUNC_TYPE func, void *param);
+WRes Thread_Wait(CThread *p);
+WRes Thread_Close(CThread *p);
+
+WRes CriticalSection_Init(CCriticalSection *p);
+void CriticalSection_Delete(CCriticalSection *p);
+void CriticalSection_Enter(CCriticalSection *p);
+void CriticalSection_Leave(CCriticalSection *p);
+
+/* Event_Wait waits for the signaled state of event and resets it */
+void Event_Construct(CAutoResetEvent *p);
+WRes AutoResetEvent_CreateNotSignaled(CAutoResetEvent *p);
+WRes Event_Set(CAutoResetEvent *p);
+WRes Event_Wait(CAutoResetEvent *p);
+WRes Event_Close(CAutoResetEvent *p);
+
+EXTERN_C_END
+
+#endif